@@ -1,7 +1,10 @@
 #include "AsyncExec.hpp"
+#include <stdexcept>
+#include <fmt/format.h>
 
 AsyncExec::AsyncExec(uv_loop_t *loop)
-    : _async{new uv_async_t}
+    : Executor{"uv"}
+    , _async{new uv_async_t}
 {
     if (int err = uv_async_init(loop, _async.get(), _Execute))
         throw std::runtime_error(fmt::format("Failed to init async: {}", uv_strerror(err)));
@@ -16,15 +19,13 @@ AsyncExec::~AsyncExec()
     uv_close(reinterpret_cast<uv_handle_t *>(_async.release()), nop);
 }
 
-void AsyncExec::_Execute(uv_async_t *a)
+void AsyncExec::_Wake()
 {
-    reinterpret_cast<AsyncExec *>(a->data)->_Execute2();
+    if (int err = uv_async_send(_async.get()))
+        throw std::runtime_error(fmt::format("Failed to send async: {}", uv_strerror(err)));
 }
 
-void AsyncExec::_Execute2()
+void AsyncExec::_Execute(uv_async_t *a)
 {
-    std::lock_guard<std::mutex> guard{_mut};
-    for (const auto &t : _tasks)
-        t();
-    _tasks.clear();
+    reinterpret_cast<AsyncExec *>(a->data)->_RunPending();
 }
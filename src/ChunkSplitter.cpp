@@ -0,0 +1,114 @@
+#include "ChunkSplitter.hpp"
+
+#include <bit>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+// A cell c is at a boundary if its class differs from the previous cell,
+// or if it starts or ends a run of spaces: a cell belongs to a run if it's
+// a space equal to one of its neighbours.
+
+void ChunkSplitter::Reserve(size_t count)
+{
+    if (_buffer.size() < PAD_BEFORE + count + PAD_AFTER)
+        _buffer.resize(PAD_BEFORE + count + PAD_AFTER);
+    // The boundaries of an empty row are {0, 1}
+    _chunks.reserve(count + 2);
+}
+
+uint32_t* ChunkSplitter::GetCells(size_t count)
+{
+    _count = count;
+    // Only grow the buffer, so the steady state doesn't allocate.
+    if (_buffer.size() < PAD_BEFORE + count + PAD_AFTER)
+        _buffer.resize(PAD_BEFORE + count + PAD_AFTER);
+    // The padding may have been overwritten by a longer row.
+    _buffer[0] = _buffer[1] = 0;
+    for (size_t i = 0; i < PAD_AFTER; ++i)
+        _buffer[PAD_BEFORE + count + i] = 0;
+    return _buffer.data() + PAD_BEFORE;
+}
+
+namespace {
+
+inline bool IsPair(const uint32_t *c, ptrdiff_t i)
+{
+    return c[i] == c[i - 1] && (c[i] & 1);
+}
+
+inline bool IsBoundary(const uint32_t *c, ptrdiff_t i)
+{
+    bool in_run = IsPair(c, i) || IsPair(c, i + 1);
+    bool prev_in_run = IsPair(c, i - 1) || IsPair(c, i);
+    return (c[i] >> 1) != (c[i - 1] >> 1) || in_run != prev_in_run;
+}
+
+#ifdef __SSE2__
+
+// Get the boundary bits for the four cells starting from c
+inline unsigned BoundaryMask4(const uint32_t *c)
+{
+    const __m128i one = _mm_set1_epi32(1);
+    __m128i prev2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c - 2));
+    __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c - 1));
+    __m128i cur = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c));
+    __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i *>(c + 1));
+
+    auto is_pair = [&](__m128i a, __m128i b) {
+        __m128i is_space = _mm_cmpeq_epi32(_mm_and_si128(a, one), one);
+        return _mm_and_si128(_mm_cmpeq_epi32(a, b), is_space);
+    };
+    __m128i pair_prev = is_pair(prev, prev2);
+    __m128i pair_cur = is_pair(cur, prev);
+    __m128i pair_next = is_pair(next, cur);
+    __m128i run_change = _mm_xor_si128(_mm_or_si128(pair_cur, pair_next), _mm_or_si128(pair_prev, pair_cur));
+    __m128i same_class = _mm_cmpeq_epi32(_mm_srli_epi32(cur, 1), _mm_srli_epi32(prev, 1));
+    __m128i boundary = _mm_or_si128(_mm_andnot_si128(same_class, _mm_set1_epi32(-1)), run_change);
+    return _mm_movemask_ps(_mm_castsi128_ps(boundary));
+}
+
+#endif //__SSE2__
+
+} //namespace;
+
+const std::vector<size_t>& ChunkSplitter::Split()
+{
+#ifdef __SSE2__
+    const uint32_t *c = _buffer.data() + PAD_BEFORE;
+    _chunks.clear();
+    _chunks.push_back(0);
+    // Eight cells at a time, the padding covers the reads past the end.
+    for (size_t i = 1; i < _count; i += 8)
+    {
+        unsigned mask = BoundaryMask4(c + i) | BoundaryMask4(c + i + 4) << 4;
+        while (mask)
+        {
+            size_t col = i + std::countr_zero(mask);
+            if (col >= _count)
+                break;
+            _chunks.push_back(col);
+            mask &= mask - 1;
+        }
+    }
+    _chunks.push_back(_count ? _count : 1);
+    return _chunks;
+#else
+    return SplitScalar();
+#endif
+}
+
+const std::vector<size_t>& ChunkSplitter::SplitScalar()
+{
+    const uint32_t *c = _buffer.data() + PAD_BEFORE;
+    _chunks.clear();
+    _chunks.push_back(0);
+    for (size_t i = 1; i < _count; ++i)
+    {
+        if (IsBoundary(c, i))
+            _chunks.push_back(i);
+    }
+    _chunks.push_back(_count ? _count : 1);
+    return _chunks;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Split a row of cells into the chunks with contiguous highlighting.
+// Contiguous spaces form their own chunks to avoid unnecessary text rerendering.
+// The cells are packed into integers (hl_class << 1 | is_space), so the run
+// boundaries are found comparing several cells at a time.
+class ChunkSplitter
+{
+public:
+    static uint32_t Pack(unsigned hl_class, bool is_space)
+    {
+        return hl_class << 1 | static_cast<uint32_t>(is_space);
+    }
+
+    // Prepare the buffers for the rows of up to count cells,
+    // so that splitting them doesn't allocate.
+    void Reserve(size_t count);
+
+    // Get the buffer for count packed cells to be split next.
+    uint32_t* GetCells(size_t count);
+
+    // Find the chunk boundaries of the cells in the buffer: {0, ..., count}.
+    // An empty row gives {0, 1}. The result is valid until the next call.
+    const std::vector<size_t>& Split();
+
+    // The straightforward cell by cell version for reference
+    const std::vector<size_t>& SplitScalar();
+
+private:
+    // The cells are padded with non-space cells to avoid checking for boundaries.
+    static constexpr size_t PAD_BEFORE = 2;
+    static constexpr size_t PAD_AFTER = 8;
+
+    std::vector<uint32_t> _buffer;
+    size_t _count = 0;
+    std::vector<size_t> _chunks;
+};
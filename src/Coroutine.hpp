@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Logger.hpp"
+#include "SlabPool.hpp"
+
+#include <coroutine>
+#include <exception>
+
+// A detached coroutine: it starts right away, and its frame is destroyed
+// when it finishes. The caller doesn't wait for the result.
+struct Coroutine
+{
+    struct promise_type
+    {
+        Coroutine get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+
+        // Nobody is waiting for the result, so there's nowhere to pass an error to.
+        // The error is logged, and the coroutine finishes as if it has returned.
+        void unhandled_exception() noexcept
+        {
+            try
+            {
+                throw;
+            }
+            catch (const std::exception &e)
+            {
+                Logger().error("Unhandled exception in a coroutine: {}", e.what());
+            }
+            catch (...)
+            {
+                Logger().error("Unhandled exception in a coroutine");
+            }
+        }
+
+        // A frame is allocated per call, the small ones are recycled by the slab pool.
+        static void* operator new(size_t size)
+        {
+            if (size <= SlabPool::MAX_BLOCK_SIZE)
+                return SlabPool::Shared().Allocate(size);
+            return ::operator new(size);
+        }
+
+        static void operator delete(void *p, size_t size)
+        {
+            if (size <= SlabPool::MAX_BLOCK_SIZE)
+                SlabPool::Shared().Deallocate(p, size);
+            else
+                ::operator delete(p);
+        }
+    };
+};
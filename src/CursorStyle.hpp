@@ -0,0 +1,28 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+// The cursor appearance in a mode, see `:help ui-mode-info`
+struct CursorStyle
+{
+    enum Shape : uint8_t
+    {
+        BLOCK = 0,
+        VERTICAL,
+        HORIZONTAL,
+    };
+    Shape shape = BLOCK;
+    // The portion of the cell occupied by the vertical or horizontal cursor
+    int cell_percentage = 100;
+    // Blinking times in milliseconds, no blinking if any of them is 0
+    int blinkwait = 0;
+    int blinkon = 0;
+    int blinkoff = 0;
+    // The highlighting of the cursor, 0 means the inverted default colors.
+    // Its color and blend are resolved by the renderer, see Renderer::CursorState.
+    unsigned attr_id = 0;
+    std::string name;
+
+    bool IsBlinking() const { return blinkwait && blinkon && blinkoff; }
+};
@@ -0,0 +1,79 @@
+#include "Executor.hpp"
+#include "Logger.hpp"
+
+namespace {
+
+const char *const LANE_NAMES[] = {"input", "present", "resize", "housekeeping"};
+
+} //namespace;
+
+Executor::Executor(const char *name)
+    : _name{name}
+{
+}
+
+Executor::~Executor()
+{
+    for (int lane = 0; lane < LANE_COUNT; ++lane)
+    {
+        auto stats = GetStats(static_cast<Lane>(lane));
+        if (!stats.executed)
+            continue;
+        auto avg = stats.total_latency / stats.executed;
+        Logger().info("Executor {} lane {}: executed={} max_depth={} avg_latency={}us max_latency={}us",
+                      _name, LANE_NAMES[lane], stats.executed, stats.max_depth,
+                      std::chrono::duration_cast<std::chrono::microseconds>(avg).count(),
+                      std::chrono::duration_cast<std::chrono::microseconds>(stats.max_latency).count());
+    }
+}
+
+void Executor::_RunPending()
+{
+    size_t budget{};
+    for (auto &l : _lanes)
+    {
+        size_t depth = l.depth.load(std::memory_order_relaxed);
+        if (depth > l.max_depth.load(std::memory_order_relaxed))
+            l.max_depth.store(depth, std::memory_order_relaxed);
+        budget += depth;
+    }
+
+    _Task t;
+    while (budget)
+    {
+        // Look from the top lane after every task, a higher priority one
+        // may have been posted meanwhile.
+        _Lane *lane = nullptr;
+        for (auto &l : _lanes)
+        {
+            if (l.queue.TryPop(t))
+            {
+                lane = &l;
+                break;
+            }
+        }
+        if (!lane)
+            break;
+        --budget;
+
+        lane->depth.fetch_sub(1, std::memory_order_relaxed);
+        auto latency = (ClockT::now() - t.posted).count();
+        lane->total_latency.fetch_add(latency, std::memory_order_relaxed);
+        if (latency > lane->max_latency.load(std::memory_order_relaxed))
+            lane->max_latency.store(latency, std::memory_order_relaxed);
+        lane->executed.fetch_add(1, std::memory_order_relaxed);
+        t.task();
+    }
+}
+
+Executor::Stats Executor::GetStats(Lane lane) const
+{
+    const auto &l = _lanes[lane];
+    Stats stats;
+    stats.depth = l.depth.load(std::memory_order_relaxed);
+    stats.max_depth = l.max_depth.load(std::memory_order_relaxed);
+    stats.executed = l.executed.load(std::memory_order_relaxed);
+    stats.total_latency = ClockT::duration{l.total_latency.load(std::memory_order_relaxed)};
+    stats.max_latency = ClockT::duration{l.max_latency.load(std::memory_order_relaxed)};
+    return stats;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "MpscQueue.hpp"
+#include "SmallTask.hpp"
+#include "Utils.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Run the tasks posted by any thread in the thread of a loop. The loop specific
+// part is waking it up, see AsyncExec for uv and GExec for GTK.
+// The tasks go to the lanes by priority: a pending input is handled before
+// anything else, even if it was posted after a resize or a font update.
+// Posting doesn't lock, the tasks are executed without any lock held too.
+class Executor
+{
+public:
+    enum Lane
+    {
+        INPUT = 0,
+        PRESENT,
+        RESIZE,
+        HOUSEKEEPING,
+        LANE_COUNT,
+    };
+
+    Executor(const char *name);
+    virtual ~Executor();
+
+    // Any thread
+    template <typename T>
+    void Post(Lane lane, T &&task)
+    {
+        auto &l = _lanes[lane];
+        l.depth.fetch_add(1, std::memory_order_relaxed);
+        l.queue.Push({SmallTask{std::forward<T>(task)}, ClockT::now()});
+        _Wake();
+    }
+
+    struct Stats
+    {
+        // The tasks posted but not started yet
+        size_t depth = 0;
+        size_t max_depth = 0;
+        uint64_t executed = 0;
+        // The time between posting and starting a task
+        ClockT::duration total_latency{};
+        ClockT::duration max_latency{};
+    };
+    // Any thread
+    Stats GetStats(Lane) const;
+
+protected:
+    // The loop thread: run the tasks pending so far, the higher lanes first.
+    // The tasks posted meanwhile are left for the next wake up.
+    void _RunPending();
+
+    // Any thread: make the loop call _RunPending() soon
+    virtual void _Wake() = 0;
+
+private:
+    const char *_name;
+
+    struct _Task
+    {
+        SmallTask task;
+        ClockT::time_point posted;
+    };
+
+    struct _Lane
+    {
+        MpscQueue<_Task> queue;
+        std::atomic<size_t> depth{0};
+        std::atomic<size_t> max_depth{0};
+        std::atomic<uint64_t> executed{0};
+        std::atomic<ClockT::rep> total_latency{0};
+        std::atomic<ClockT::rep> max_latency{0};
+    };
+    std::array<_Lane, LANE_COUNT> _lanes;
+};
@@ -0,0 +1,59 @@
+#include "FlushPolicy.hpp"
+
+#include <algorithm>
+
+
+FlushPolicy::FlushPolicy(std::chrono::milliseconds budget)
+    : _budget{budget}
+{
+}
+
+void FlushPolicy::SetBudget(std::chrono::milliseconds budget)
+{
+    _budget = std::clamp(budget, std::chrono::milliseconds{1}, MAX_INTERVAL);
+}
+
+void FlushPolicy::NotifyInput(ClockT::time_point now)
+{
+    _last_input_time.store(now, std::memory_order_relaxed);
+}
+
+void FlushPolicy::_Average(DurationT &avg, DurationT sample)
+{
+    // The weight of the new sample is 1/4: a single slow frame doesn't matter much,
+    // but the average follows the sustained changes quickly enough.
+    avg += (sample - avg) / 4;
+}
+
+void FlushPolicy::ReportFlushCost(DurationT cost)
+{
+    _Average(_flush_cost, cost);
+}
+
+void FlushPolicy::ReportPresentCost(DurationT cost)
+{
+    _Average(_present_cost, cost);
+}
+
+FlushPolicy::DurationT FlushPolicy::GetInterval(ClockT::time_point now) const
+{
+    auto cost = GetFrameCost();
+
+    // Respond to the user without delay unless the frames are too expensive.
+    auto since_input = now - _last_input_time.load(std::memory_order_relaxed);
+    if (since_input < INPUT_WINDOW && cost <= _budget)
+        return DurationT::zero();
+
+    // Under the load, leave at least as much time for the rest of the work
+    // as the frames take. The cheap frames are limited by the budget.
+    return std::clamp<DurationT>(2 * cost, _budget, MAX_INTERVAL);
+}
+
+FlushPolicy::DurationT FlushPolicy::GetDelay(ClockT::time_point now, ClockT::time_point last_flush) const
+{
+    auto elapsed = now - last_flush;
+    auto interval = GetInterval(now);
+    if (elapsed >= interval)
+        return DurationT::zero();
+    return interval - elapsed;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Utils.hpp"
+
+#include <atomic>
+#include <chrono>
+
+// Decide when the grid should be flushed to the screen. Isolated keystrokes
+// are presented immediately if the frames are cheap, while sustained updates
+// (like scrolling) are throttled according to the measured cost of the frames.
+class FlushPolicy
+{
+public:
+    using DurationT = ClockT::duration;
+
+    FlushPolicy(std::chrono::milliseconds budget = DEFAULT_BUDGET);
+
+    static constexpr std::chrono::milliseconds DEFAULT_BUDGET{16};
+    // The flushes never get sparser than this
+    static constexpr std::chrono::milliseconds MAX_INTERVAL{250};
+    // The input is considered recent for this long
+    static constexpr std::chrono::milliseconds INPUT_WINDOW{100};
+
+    // The target time of a frame
+    void SetBudget(std::chrono::milliseconds);
+    std::chrono::milliseconds GetBudget() const { return _budget; }
+
+    // The user has pressed a key, may be called from any thread.
+    void NotifyInput(ClockT::time_point now = ClockT::now());
+
+    // The measured time spent preparing and presenting a frame
+    void ReportFlushCost(DurationT);
+    void ReportPresentCost(DurationT);
+    DurationT GetFrameCost() const { return _flush_cost + _present_cost; }
+
+    // The minimal time between two consecutive flushes
+    DurationT GetInterval(ClockT::time_point now) const;
+    // How long to wait before flushing, zero if the flush should be done right away
+    DurationT GetDelay(ClockT::time_point now, ClockT::time_point last_flush) const;
+
+private:
+    std::chrono::milliseconds _budget;
+    std::atomic<ClockT::time_point> _last_input_time{};
+    // Exponentially weighted moving averages of the costs
+    DurationT _flush_cost{};
+    DurationT _present_cost{};
+
+    static void _Average(DurationT &avg, DurationT sample);
+};
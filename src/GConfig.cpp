@@ -71,3 +71,33 @@ void GConfig::SetCellHeightAdjustment(double v)
 {
     _settings.set_double(CELL_HEIGHT_ADJUSTMENT_KEY, v);
 }
+
+int GConfig::GetTextureCacheSize()
+{
+    return _settings.get_int(TEXTURE_CACHE_SIZE_KEY);
+}
+
+void GConfig::SetTextureCacheSize(int count)
+{
+    _settings.set_int(TEXTURE_CACHE_SIZE_KEY, count);
+}
+
+int GConfig::GetFrameBudget()
+{
+    return _settings.get_int(FRAME_BUDGET_KEY);
+}
+
+void GConfig::SetFrameBudget(int ms)
+{
+    _settings.set_int(FRAME_BUDGET_KEY, ms);
+}
+
+int GConfig::GetCoalesceFrames()
+{
+    return _settings.get_int(COALESCE_FRAMES_KEY);
+}
+
+void GConfig::SetCoalesceFrames(int frames)
+{
+    _settings.set_int(COALESCE_FRAMES_KEY, frames);
+}
@@ -16,6 +16,9 @@ public:
     static constexpr const char *FONT_SIZE_KEY = "font-size";
     static constexpr const char *SMOOTH_SCROLL_DELAY_KEY = "smooth-scroll-delay";
     static constexpr const char *CELL_HEIGHT_ADJUSTMENT_KEY = "cell-height-adjustment";
+    static constexpr const char *TEXTURE_CACHE_SIZE_KEY = "texture-cache-size";
+    static constexpr const char *FRAME_BUDGET_KEY = "frame-budget";
+    static constexpr const char *COALESCE_FRAMES_KEY = "coalesce-frames";
 
     static std::string GetFontFamily();
     static void SetFontFamily(const std::string &);
@@ -28,6 +31,18 @@ public:
     static int GetSmoothScrollDelay();
     static void SetSmoothScrollDelay(int);
 
+    // Count of offscreen line textures to keep for reuse
+    static int GetTextureCacheSize();
+    static void SetTextureCacheSize(int);
+
+    // Target milliseconds per frame, the flushes are throttled under load
+    static int GetFrameBudget();
+    static void SetFrameBudget(int);
+
+    // Merge the rows unchanged for this many frames into blocks; if 0, don't
+    static int GetCoalesceFrames();
+    static void SetCoalesceFrames(int);
+
 private:
     using _SettingsSchemaT = gir::Owned<gir::Gio::SettingsSchema>;
     static _SettingsSchemaT _settings_schema;
@@ -1,6 +1,8 @@
 #include "GCursor.hpp"
 #include "GGrid.hpp"
 
+#include <algorithm>
+
 #ifdef GIR_INLINE
 #include <Gtk/DrawingArea.ipp>
 #include <Gtk/Fixed.ipp>
@@ -18,45 +20,56 @@ GCursor::GCursor(Gtk::DrawingArea cursor, GGrid *grid, Session::AtomicPtrT &sess
         reinterpret_cast<GCursor *>(data)->_DrawCursor(da, cr, width, height);
     };
     cursor.set_draw_func(drawCursor, this, nullptr);
+
+    // The cursor stays in the grid, it's only moved around or hidden
+    _cursor.set_visible(false);
+    _grid->GetFixed().put(_cursor, 0, 0);
 }
 
-void GCursor::_DrawCursor(GtkDrawingArea *, cairo_t *cr, int /*width*/, int /*height*/)
+GCursor::~GCursor()
 {
-    auto session = _session.load();
-    if (!session)
-        return;
+    _StopBlink();
+}
+
+const CursorStyle& GCursor::_GetStyle() const
+{
+    static const CursorStyle DEFAULT_STYLE;
+    return _state.mode_idx < _styles.size() ? _styles[_state.mode_idx] : DEFAULT_STYLE;
+}
 
-    auto renderer = session->GetRenderer();
-    auto lock = renderer->Lock();
+void GCursor::_DrawCursor(GtkDrawingArea *, cairo_t *cr, int /*width*/, int /*height*/)
+{
     double cell_width = _grid->CalcX(1);
     double cell_height = _grid->CalcY(1);
 
+    const auto &style = _GetStyle();
+
     cairo_save(cr);
-    unsigned fg = renderer->GetFg();
+    unsigned color = _state.color;
     cairo_set_source_rgba(cr,
-        static_cast<double>(fg >> 16) / 255,
-        static_cast<double>((fg >> 8) & 0xff) / 255,
-        static_cast<double>(fg & 0xff) / 255,
-        0.5);
+        static_cast<double>(color >> 16) / 255,
+        static_cast<double>((color >> 8) & 0xff) / 255,
+        static_cast<double>(color & 0xff) / 255,
+        1 - _state.blend / 100.0);
 
-    const auto &mode = renderer->GetMode();
-    if (mode == "insert")
-    {
-        cairo_rectangle(cr, 0, 0, 0.2 * cell_width, cell_height);
-    }
-    else if (mode == "replace" || mode == "operator")
-    {
-        cairo_rectangle(cr, 0, 0.75 * cell_height, cell_width, 0.25 * cell_height);
-    }
-    else
+    double portion = std::clamp(style.cell_percentage, 1, 100) / 100.0;
+    switch (style.shape)
     {
+    case CursorStyle::VERTICAL:
+        cairo_rectangle(cr, 0, 0, portion * cell_width, cell_height);
+        break;
+    case CursorStyle::HORIZONTAL:
+        cairo_rectangle(cr, 0, (1 - portion) * cell_height, cell_width, portion * cell_height);
+        break;
+    default:
         cairo_rectangle(cr, 0, 0, cell_width, cell_height);
+        break;
     }
     cairo_fill(cr);
     cairo_restore(cr);
 }
 
-void GCursor::Move()
+void GCursor::Update()
 {
     auto session = _session.load();
     if (!session)
@@ -64,29 +77,103 @@ void GCursor::Move()
         Hide();
         return;
     }
-    auto renderer = session->GetRenderer();
+    auto state = session->GetRenderer()->GetCursorState();
+    if (state.busy)
+    {
+        Hide();
+        return;
+    }
 
-    Hide();
-    if (!renderer->IsBusy())
+    // The labels are added to the grid later, keep the cursor on top of them
+    auto fixed = _grid->GetFixed();
+    auto *widget = GTK_WIDGET(_cursor.g_obj());
+    if (gtk_widget_get_last_child(GTK_WIDGET(fixed.g_obj())) != widget)
+        gtk_widget_insert_before(widget, GTK_WIDGET(fixed.g_obj()), nullptr);
+
+    bool moved = !_placed || state.row != _state.row || state.col != _state.col;
+    if (moved)
     {
-        // Move the cursor
-        _grid->GetFixed().put(_cursor,
-                _grid->CalcX(renderer->GetCursorCol()),
-                _grid->CalcY(renderer->GetCursorRow()));
+        fixed.move(_cursor, _grid->CalcX(state.col), _grid->CalcY(state.row));
+        _placed = true;
     }
+    bool restyled = state.mode_idx != _state.mode_idx || state.color != _state.color || state.blend != _state.blend;
+    if (restyled)
+        _cursor.queue_draw();
+    _state = state;
+    // The cursor is shown steadily for a while after moving, like in the terminal
+    if (moved || restyled || !_cursor.get_visible())
+        _RestartBlink();
+    _cursor.set_visible(true);
 }
 
 void GCursor::Hide()
 {
-    if (_cursor.get_parent())
+    _StopBlink();
+    _cursor.set_visible(false);
+}
+
+void GCursor::SetStyles(const std::vector<CursorStyle> &styles)
+{
+    _styles = styles;
+    _cursor.queue_draw();
+    _RestartBlink();
+}
+
+void GCursor::SetFocused(bool focused)
+{
+    _focused = focused;
+    _RestartBlink();
+}
+
+void GCursor::_RestartBlink()
+{
+    _StopBlink();
+    const auto &style = _GetStyle();
+    // No wakeups at all while not blinking
+    if (!_focused || !style.IsBlinking())
+        return;
+    _ScheduleBlink(style.blinkwait);
+}
+
+void GCursor::_ScheduleBlink(int ms)
+{
+    auto on_timeout = [](gpointer data) -> gboolean {
+        auto *self = reinterpret_cast<GCursor *>(data);
+        self->_blink_timer_id = 0;
+        self->_OnBlink();
+        return FALSE;
+    };
+    _blink_timer_id = g_timeout_add(ms, on_timeout, this);
+}
+
+void GCursor::_StopBlink()
+{
+    if (_blink_timer_id)
     {
-        _cursor.ref();
-        _grid->GetFixed().remove(_cursor);
+        g_source_remove(_blink_timer_id);
+        _blink_timer_id = 0;
     }
+    if (!_blink_on)
+    {
+        _blink_on = true;
+        _cursor.set_opacity(1);
+    }
+}
+
+void GCursor::_OnBlink()
+{
+    // Changing the opacity only redraws the cursor on the next frame
+    _blink_on = !_blink_on;
+    _cursor.set_opacity(_blink_on ? 1 : 0);
+
+    const auto &style = _GetStyle();
+    _ScheduleBlink(_blink_on ? style.blinkon : style.blinkoff);
 }
 
 void GCursor::UpdateSize()
 {
     _cursor.set_content_width(std::round(_grid->CalcX(1)));
     _cursor.set_content_height(_grid->CalcY(1));
+    // The cell size may have changed
+    _placed = false;
 }
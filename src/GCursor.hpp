@@ -11,15 +11,37 @@ class GCursor
 {
 public:
     GCursor(Gtk::DrawingArea cursor, GGrid *, Session::AtomicPtrT &);
+    ~GCursor();
 
-    void Move();
+    // Follow the cursor state published by the renderer, no locking required.
+    // The widget is only moved or redrawn if the state has changed.
+    void Update();
     void Hide();
     void UpdateSize();
+    // The cursor styles for every mode, see Renderer::GetCursorStyles()
+    void SetStyles(const std::vector<CursorStyle> &);
+    // Don't blink while the window isn't focused
+    void SetFocused(bool);
 
 private:
     Gtk::DrawingArea _cursor;
     GGrid *_grid;
     Session::AtomicPtrT &_session;
+    // The state being displayed
+    Renderer::CursorState _state;
+    // Is the widget at the position of _state?
+    bool _placed = false;
+    std::vector<CursorStyle> _styles;
+    const CursorStyle& _GetStyle() const;
+
+    // Blinking: one timer per phase, only the cursor widget is redrawn
+    bool _focused = true;
+    bool _blink_on = true;
+    guint _blink_timer_id = 0;
+    void _RestartBlink();
+    void _StopBlink();
+    void _ScheduleBlink(int ms);
+    void _OnBlink();
 
     void _DrawCursor(GtkDrawingArea *, cairo_t *cr, int /*width*/, int /*height*/);
 };
@@ -0,0 +1,35 @@
+#include "GExec.hpp"
+
+GExec::GExec()
+    : Executor{"gtk"}
+{
+    static GSourceFuncs funcs = [] {
+        GSourceFuncs funcs{};
+        funcs.dispatch = _Dispatch;
+        return funcs;
+    }();
+    _source = g_source_new(&funcs, sizeof(_Source));
+    reinterpret_cast<_Source *>(_source)->exec = this;
+    g_source_set_name(_source, "executor");
+    g_source_attach(_source, nullptr);
+}
+
+GExec::~GExec()
+{
+    g_source_destroy(_source);
+    g_source_unref(_source);
+}
+
+void GExec::_Wake()
+{
+    // Thread safe, wakes up the main context
+    g_source_set_ready_time(_source, 0);
+}
+
+gboolean GExec::_Dispatch(GSource *source, GSourceFunc, gpointer)
+{
+    // Rearm before running: the tasks posted meanwhile make it ready again.
+    g_source_set_ready_time(source, -1);
+    reinterpret_cast<_Source *>(source)->exec->_RunPending();
+    return G_SOURCE_CONTINUE;
+}
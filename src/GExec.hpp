@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Executor.hpp"
+#include <glib.h>
+
+// The executor of the GTK main loop. A single persistent source is made ready
+// to wake up the loop, so posting doesn't allocate a source every time.
+class GExec
+    : public Executor
+{
+public:
+    GExec();
+    ~GExec();
+
+private:
+    struct _Source
+    {
+        GSource source;
+        GExec *exec;
+    };
+    GSource *_source;
+
+    void _Wake() override;
+    static gboolean _Dispatch(GSource *, GSourceFunc, gpointer);
+};
@@ -12,8 +12,13 @@
 #include "Gtk/PropagationPhase.hpp"
 #include "Gtk/StyleContext.hpp"
 
+#include <cmath>
 #include <sstream>
+#include <string_view>
 #include <numeric>
+#include <algorithm>
+#include <unordered_set>
+#include <limits>
 #include <boost/algorithm/string.hpp>
 
 #ifdef GIR_INLINE
@@ -35,10 +40,18 @@ GGrid::GGrid(Gtk::Fixed grid, GFont &font, Session::AtomicPtrT &session, IWindow
     , _session{session}
     , _window_handler{window_handler}
     , _css_provider{Gtk::CssProvider::new_()}
+    , _label_cache{0, [](Gtk::Widget &widget) { widget.unref(); }}
 {
     _grid.set_focusable(true);
     _grid.get_style_context().add_provider(_css_provider.get(), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
 
+    // The scroll layer is clipped to the scrolled region while translated
+    _scroll_clip = Gtk::Fixed::new_().g_obj();
+    _scroll_layer = Gtk::Fixed::new_().g_obj();
+    gtk_widget_set_overflow(GTK_WIDGET(_scroll_clip.g_obj()), GTK_OVERFLOW_HIDDEN);
+    _scroll_clip.put(_scroll_layer, 0, 0);
+    _grid.put(_scroll_clip, 0, 0);
+
     Gtk::DrawingArea cursor = Gtk::DrawingArea::new_().g_obj();
     _cursor.reset(new GCursor{cursor, this, _session});
 
@@ -51,6 +64,39 @@ GGrid::GGrid(Gtk::Fixed grid, GFont &font, Session::AtomicPtrT &session, IWindow
         _OnKeyReleased(keyval, keycode, state);
     });
     grid.add_controller(controller);
+
+    _WatchSetting(GConfig::TEXTURE_CACHE_SIZE_KEY);
+    _WatchSetting(GConfig::FRAME_BUDGET_KEY);
+    _WatchSetting(GConfig::SMOOTH_SCROLL_DELAY_KEY);
+    _WatchSetting(GConfig::COALESCE_FRAMES_KEY);
+}
+
+GGrid::~GGrid()
+{
+    for (auto id : _settings_handlers)
+        g_signal_handler_disconnect(GConfig::GetSettings().g_obj(), id);
+}
+
+void GGrid::_WatchSetting(const char *key)
+{
+    std::string signal = std::string{"changed::"} + key;
+    _settings_handlers.push_back(g_signal_connect(GConfig::GetSettings().g_obj(), signal.c_str(),
+                G_CALLBACK(MakeCallback<&GGrid::_OnSettingChanged>()), this));
+    // Reading the key also makes GSettings report its changes
+    _OnSettingChanged(nullptr, const_cast<gchar *>(key));
+}
+
+void GGrid::_OnSettingChanged(GSettings *, gchar *key)
+{
+    std::string_view k{key};
+    if (k == GConfig::TEXTURE_CACHE_SIZE_KEY)
+        _label_cache.SetCapacity(GConfig::GetTextureCacheSize());
+    else if (k == GConfig::FRAME_BUDGET_KEY)
+        _frame_budget = std::chrono::milliseconds{GConfig::GetFrameBudget()};
+    else if (k == GConfig::SMOOTH_SCROLL_DELAY_KEY)
+        _smooth_scroll_delay = GConfig::GetSmoothScrollDelay();
+    else if (k == GConfig::COALESCE_FRAMES_KEY)
+        _coalesce_frames = GConfig::GetCoalesceFrames();
 }
 
 namespace {
@@ -87,6 +133,18 @@ void GGrid::MeasureCell()
 }
 
 void GGrid::UpdateStyle(Session *session)
+{
+    // The font may have changed, the whole style is updated then, and the cell remeasured.
+    _UpdateCss(session);
+    // The labels created before can't be reused anymore
+    ++_style_generation;
+    _DissolveBlocks();
+
+    MeasureCell();
+    _window_handler->CheckSizeAsync();
+}
+
+void GGrid::_UpdateCss(Session *session)
 {
     assert(session);
 
@@ -115,6 +173,11 @@ void GGrid::UpdateStyle(Session *session)
     }
     oss << "}\n";
 
+    // The backgrounds of the cells are filled under the labels
+    oss << "label {\n";
+    oss << "background-color: transparent;\n";
+    oss << "}\n";
+
     oss << "label.status {\n";
     oss << "color: #cccccc;\n";
     oss << "}\n";
@@ -122,70 +185,6 @@ void GGrid::UpdateStyle(Session *session)
     std::string style = oss.str();
     Logger().debug("Updated CSS Style:\n{}", style);
     _css_provider.load_from_data(style.data(), -1);
-
-    _UpdatePangoStyles(session);
-
-    MeasureCell();
-    _window_handler->CheckSizeAsync();
-}
-
-std::string GGrid::_MakePangoStyle(const HlAttr &attr, const HlAttr &def_attr)
-{
-    std::ostringstream oss;
-    if ((attr.flags & HlAttr::F_REVERSE))
-    {
-        auto fg = attr.fg.value_or(def_attr.fg.value());
-        auto bg = attr.bg.value_or(def_attr.bg.value());
-        oss << fmt::format(" background=\"#{:06x}\"", fg);
-        oss << fmt::format(" color=\"#{:06x}\"", bg);
-    }
-    else
-    {
-        if (attr.bg.has_value())
-            oss << fmt::format(" background=\"#{:06x}\"", attr.bg.value());
-        if (attr.fg.has_value())
-            oss << fmt::format(" color=\"#{:06x}\"", attr.fg.value());
-    }
-    if ((attr.flags & HlAttr::F_ITALIC))
-        oss << " style=\"italic\"";
-    if ((attr.flags & HlAttr::F_BOLD))
-        oss << " weight=\"bold\"";
-
-    if ((attr.flags & HlAttr::F_TEXT_DECORATION))
-    {
-        if ((attr.flags & HlAttr::F_UNDERUNDERLINE))
-            oss << " underline=\"single\"";
-        else if ((attr.flags & HlAttr::F_UNDERCURL))
-            oss << " underline=\"error\"";
-        //else if ((attr.flags & HlAttr::F_UNDERDASH))
-        //    style = "dashed";
-        //else if ((attr.flags & HlAttr::F_UNDERDOT))
-        //    style = "dotted";
-        if (attr.special.has_value())
-            oss << fmt::format(" underline_color=\"#{:06x}\"", attr.special.value());
-    }
-    else if ((attr.flags & HlAttr::F_STRIKETHROUGH))
-    {
-        oss << " strikethrough=\"true\"";
-    }
-    return oss.str();
-}
-
-void GGrid::_UpdatePangoStyles(Session *session)
-{
-    auto renderer = session->GetRenderer();
-    assert(renderer);
-
-    auto def_attr = renderer->GetDefAttr();
-    _default_pango_style = _MakePangoStyle(def_attr, def_attr);
-
-    _pango_styles.clear();
-    for (const auto &id_attr : renderer->GetAttrMap())
-    {
-        int id = id_attr.first;
-        const auto &attr = id_attr.second;
-        _pango_styles[id] = _MakePangoStyle(attr, def_attr);
-    }
 }
 
 void GGrid::Present(int width, int height)
@@ -196,29 +195,82 @@ void GGrid::Present(int width, int height)
     auto renderer = session->GetRenderer();
     assert(renderer);
     auto guard = renderer->Lock();
+    auto start_time = ClockT::now();
 
-    if (renderer->IsAttrMapModified())
+    if (renderer->IsDefAttrModified())
     {
-        renderer->MarkAttrMapProcessed();
-        UpdateStyle(session.get());
+        // The default colors are in the CSS, and the reverse highlighting
+        // depends on them too. No need to measure the cells though.
+        _UpdateCss(session.get());
+        ++_style_generation;
+        // The blocks are pictures of the old style
+        _DissolveBlocks();
     }
+    renderer->MarkAttrMapProcessed();
+
+    // The scrolled region is animated, its labels go to the scroll layer
+    auto scroll = renderer->TakeScroll();
+    bool animate_scroll = scroll.rows && _smooth_scroll_delay;
+    _scroll_rows = animate_scroll ? scroll.rows : 0;
+    if (animate_scroll)
+    {
+        // The labels are moving, the blocks can't follow them
+        _DissolveBlocks();
+        _SetScrollRegion(scroll.top, scroll.bot, renderer->GetWidth());
+        _ShiftScrolledOut();
+    }
+    _UpdateRowAges(renderer->GetGridLines());
 
     // Create and place new labels
     _UpdateLabels(session.get());
+    _CoalesceRows(renderer->GetGridLines());
 
-    _cursor->Move();
+    if (renderer->IsCursorStylesModified())
+    {
+        _cursor->SetStyles(renderer->GetCursorStyles());
+        renderer->MarkCursorStylesProcessed();
+    }
+
+    if (animate_scroll)
+        _StartScroll(scroll.rows);
+
+    _cursor->Update();
     _grid.set_cursor_from_name(renderer->IsBusy() ? "progress" : "default");
     _CheckSize(width, height, session.get());
+
+    // Let the renderer adapt the flush rate to the cost of the frames
+    auto &flush_policy = renderer->GetFlushPolicy();
+    flush_policy.SetBudget(_frame_budget);
+    flush_policy.ReportPresentCost(ClockT::now() - start_time);
+}
+
+void GGrid::PresentCursor()
+{
+    _cursor->Update();
+}
+
+void GGrid::SetFocused(bool focused)
+{
+    _cursor->SetFocused(focused);
 }
 
 void GGrid::Clear()
 {
+    _DissolveBlocks();
+    _block_rows.clear();
+    _row_ages.clear();
     for (auto &[_, texture]: _textures)
-    {
-        _MoveLabel(texture.label, -1);
-        _grid.remove(texture.label);
-    }
+        _GetContainer(texture).remove(texture.widget);
     _textures.clear();
+    for (auto &[_, placeholder]: _placeholders)
+        _GetContainer(placeholder.second).remove(placeholder.second.widget);
+    _placeholders.clear();
+    for (auto &[_, texture]: _scrolled_out)
+        _scroll_layer.remove(texture.widget);
+    _scrolled_out.clear();
+    _scroll_from = 0;
+    _SetScrollOffset(0);
+    _label_cache.Clear();
     _cursor->Hide();
 }
 
@@ -308,6 +360,7 @@ gboolean GGrid::_OnKeyPressed(guint keyval, guint /*keycode*/, GdkModifierType s
         g_string_printf(input.get(), "<%s>", raw.c_str());
     }
 
+    renderer->GetFlushPolicy().NotifyInput();
     session->GetInput()->Accept(input->str);
     return true;
 }
@@ -393,8 +446,9 @@ private:
     std::unordered_map<int, double> _times;
 };
 
-std::string XmlEscape(std::string s)
+std::string XmlEscape(std::string_view sv)
 {
+    std::string s{sv};
     using boost::algorithm::replace_all;
     replace_all(s, "&",  "&amp;");
     replace_all(s, "\"", "&quot;");
@@ -412,133 +466,500 @@ void GGrid::_UpdateLabels(Session *session)
 
     // Count how many new textures are going to be created
     int labels_created{};
+    // And how many are taken from the cache of the recently removed
+    int labels_reused{};
 
     // Create the newly appearing labels
     auto renderer = session->GetRenderer();
     auto &grid_lines = renderer->GetGridLines();
 
     decltype(_textures) new_textures;
-    new_textures.reserve(grid_lines.size());
+    new_textures.reserve(_textures.size());
+
+    // The chunks that need new labels to be created: (row, chunk)
+    std::vector<std::pair<int, const Renderer::ChunkT *>> missing;
 
     for (int row = 0, rowN = grid_lines.size(); row < rowN; ++row)
     {
-        const auto &chunk = grid_lines[row];
-        if (!chunk)
+        const auto &line_row = grid_lines[row];
+        if (!line_row)
             continue;
 
-        int y = row * _cell_height;
-
-        auto it = _textures.find(chunk);
-        if (it == _textures.end())
+        for (const auto *chunks : {&line_row->backgrounds, &line_row->chunks})
+        for (const auto &chunk : *chunks)
         {
-            std::string text;
-            for (const auto &word : chunk->words)
+            auto it = _textures.find(chunk);
+            if (it == _textures.end())
             {
-                auto it = _pango_styles.find(word.hl_id);
-                const std::string &pango_style = it == _pango_styles.end()
-                    ? _default_pango_style
-                    : it->second;
-                text += "<span" + pango_style + ">";
-                // If a chunk starts with spaces and the first non-space character is
-                // has a wide glyph, spaces may be rendered too narrow.
-                // To cope with that, we could span spaces with explicit font.
-                auto spaces = word.text.find_first_not_of(" ");
-                if (spaces)
+                if (auto widget = _label_cache.Take({chunk, _style_generation}))
                 {
-                    text += "<span font=\"" + _font.GetFamily() + "\">";
-                    text += word.text.substr(0, spaces);
-                    text += "</span>";
-                    if (spaces != std::string::npos)
-                        text += XmlEscape(word.text.substr(spaces));
+                    Texture t{row, chunk->col, *widget, _style_generation, false, chunk->words.empty()};
+                    _PlaceLabel(t, row, true);
+                    // The grid holds the label now
+                    t.widget.unref();
+                    ++labels_reused;
+                    new_textures[chunk] = std::move(t);
                 }
                 else
                 {
-                    text += XmlEscape(word.text);
+                    missing.emplace_back(row, &chunk);
                 }
-                text += "</span>";
             }
-            Texture t{row, Gtk::Label::new_("").g_obj()};
-            t.label.set_markup(text.c_str());
-            t.label.set_sensitive(false);
-            t.label.set_can_focus(false);
-            t.label.set_focus_on_click(false);
-            t.label.get_style_context().add_provider(_css_provider.get(), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
-
-            _grid.put(t.label, 0, y);
-            new_textures[chunk] = std::move(t);
-            ++labels_created;
-        }
-        else
-        {
-            if (it->second.row != row)
+            else
             {
-                _MoveLabel(it->second.label, y);
-                it->second.row = row;
+                if (it->second.row != row)
+                    _PlaceLabel(it->second, row, false);
+                new_textures[chunk] = it->second;
+                _textures.erase(it);
             }
-            new_textures[chunk] = it->second;
-            _textures.erase(it);
         }
     }
 
-    for (auto &[_, texture]: _textures)
+    // Creating labels is expensive, a huge redraw could freeze the window.
+    // So the labels are created in the order of importance: the command line,
+    // the cursor row and outwards from it, until the frame budget is exhausted.
+    // The rest of the rows are done in the next frames.
+    int last_row = static_cast<int>(grid_lines.size()) - 1;
+    int cursor_row = renderer->GetCursorRow();
+    auto priority = [&](int row) {
+        return row == last_row ? -1 : std::abs(row - cursor_row);
+    };
+    std::stable_sort(missing.begin(), missing.end(),
+            [&](const auto &a, const auto &b) { return priority(a.first) < priority(b.first); });
+
+    auto budget = _frame_budget;
+    size_t created_count = 0;
+    for (; created_count < missing.size(); ++created_count)
     {
-        _MoveLabel(texture.label, -1);
-        _grid.remove(texture.label);
+        auto [row, chunk] = missing[created_count];
+        // The most important rows are always done. The chunks of a row are
+        // created together not to mix them with the placeholders.
+        bool row_start = !created_count || missing[created_count - 1].first != row;
+        if (row_start && priority(row) > 0 && ClockT::now() - start_time > budget)
+            break;
+        Texture t = _CreateTexture(row, **chunk, renderer->GetHlTable());
+        _PlaceLabel(t, row, true);
+        ++labels_created;
+        new_textures[*chunk] = std::move(t);
+    }
+
+    // The deferred rows keep showing whatever was there before
+    // until their labels are created.
+    std::unordered_set<int> deferred_rows;
+    for (size_t i = created_count; i < missing.size(); ++i)
+        deferred_rows.insert(missing[i].first);
+    for (auto it = _placeholders.begin(); it != _placeholders.end(); )
+    {
+        if (deferred_rows.contains(it->first))
+        {
+            ++it;
+            continue;
+        }
+        _RemoveTexture(it->second.first, it->second.second);
+        it = _placeholders.erase(it);
+    }
+    for (auto &[chunk, texture]: _textures)
+    {
+        if (deferred_rows.contains(texture.row))
+            _placeholders.emplace(texture.row, std::make_pair(chunk, texture));
+        else if (!_KeepScrolledOut(chunk, texture))
+            _RemoveTexture(chunk, texture);
     }
 
     _textures.swap(new_textures);
 
+    if (created_count < missing.size())
+        _window_handler->PresentAsync();
+
     auto finish_time = ClockT::now();
     auto duration = ToMs(finish_time - start_time).count();
-    Logger().debug("GGrid::_UpdateLabels labels_created={} in {} ms", labels_created, duration);
+    Logger().debug("GGrid::_UpdateLabels labels_created={} labels_reused={} labels_deferred={} in {} ms",
+                   labels_created, labels_reused, missing.size() - created_count, duration);
 }
 
-void GGrid::_MoveLabel(Gtk::Label label, int new_y)
+GGrid::Texture GGrid::_CreateTexture(int row, const GridLine::Chunk &chunk, const HlTable &hl_table)
 {
-    int delay = GConfig::GetSmoothScrollDelay();
-    if (!delay)
+    if (chunk.words.empty())
+        return Texture{row, chunk.col, _CreateBackground(chunk), _style_generation, false, true};
+    return Texture{row, chunk.col, _CreateLabel(chunk, hl_table), _style_generation, false, false};
+}
+
+Gtk::Label GGrid::_CreateLabel(const GridLine::Chunk &chunk, const HlTable &hl_table)
+{
+    std::string text;
+    for (const auto &word : chunk.words)
     {
-        if (new_y != -1)
-            _grid.move(label, 0, new_y);
+        const std::string &pango_style = hl_table.GetText(word.text_class).pango_style;
+        text += "<span" + pango_style + ">";
+        // If a chunk starts with spaces and the first non-space character is
+        // has a wide glyph, spaces may be rendered too narrow.
+        // To cope with that, we could span spaces with explicit font.
+        std::string_view word_text{word.text};
+        auto spaces = word_text.find_first_not_of(" ");
+        if (spaces)
+        {
+            text += "<span font=\"" + _font.GetFamily() + "\">";
+            text += word_text.substr(0, spaces);
+            text += "</span>";
+            if (spaces != word_text.npos)
+                text += XmlEscape(word_text.substr(spaces));
+        }
+        else
+        {
+            text += XmlEscape(word_text);
+        }
+        text += "</span>";
+    }
+    Gtk::Label label{Gtk::Label::new_("").g_obj()};
+    label.set_markup(text.c_str());
+    label.set_sensitive(false);
+    label.set_can_focus(false);
+    label.set_focus_on_click(false);
+    label.get_style_context().add_provider(_css_provider.get(), GTK_STYLE_PROVIDER_PRIORITY_APPLICATION);
+    return label;
+}
+
+Gtk::DrawingArea GGrid::_CreateBackground(const GridLine::Chunk &chunk)
+{
+    // Just a solid fill of the cells, nothing to shape
+    Gtk::DrawingArea area = Gtk::DrawingArea::new_().g_obj();
+    area.set_content_width(std::ceil(CalcX(chunk.GetEnd()) - CalcX(chunk.col)));
+    area.set_content_height(_cell_height);
+    area.set_can_focus(false);
+    area.set_can_target(false);
+    auto fill = [](GtkDrawingArea *, cairo_t *cr, int /*width*/, int /*height*/, gpointer data) {
+        unsigned color = GPOINTER_TO_UINT(data);
+        cairo_set_source_rgb(cr,
+            static_cast<double>(color >> 16) / 255,
+            static_cast<double>((color >> 8) & 0xff) / 255,
+            static_cast<double>(color & 0xff) / 255);
+        cairo_paint(cr);
+    };
+    area.set_draw_func(fill, GUINT_TO_POINTER(chunk.bg), nullptr);
+    return area;
+}
+
+void GGrid::_RemoveTexture(const Renderer::ChunkT &chunk, Texture &texture)
+{
+    auto container = _GetContainer(texture);
+    if (texture.style_generation != _style_generation)
+    {
+        // The label is outdated, no point in keeping it
+        container.remove(texture.widget);
         return;
     }
-    // Check if the label is to be taken out first, no more movement.
-    if (-1 == new_y)
+    // Keep the label alive in the cache after taking it out of the grid
+    texture.widget.ref();
+    container.remove(texture.widget);
+    _label_cache.Put({chunk, texture.style_generation}, texture.widget);
+}
+
+void GGrid::_PlaceLabel(Texture &texture, int row, bool is_new)
+{
+    bool in_layer = row >= _scroll_top && row < _scroll_bot;
+    auto container = in_layer ? _scroll_layer : _grid;
+    double x = CalcX(texture.col);
+    double y = CalcY(in_layer ? row - _scroll_top : row);
+
+    if (!is_new && in_layer == texture.in_layer)
     {
-        _labels_positions.erase(label.g_obj());
+        container.move(texture.widget, x, y);
+    }
+    else if (is_new)
+    {
+        container.put(texture.widget, x, y);
+    }
+    else
+    {
+        // Reparent keeping the label alive
+        texture.widget.ref();
+        _GetContainer(texture).remove(texture.widget);
+        container.put(texture.widget, x, y);
+        texture.widget.unref();
+    }
+    // Keep the backgrounds below the text, the first children are drawn first
+    if (texture.is_background && (is_new || in_layer != texture.in_layer))
+        gtk_widget_insert_after(GTK_WIDGET(texture.widget.g_obj()), GTK_WIDGET(container.g_obj()), nullptr);
+    texture.row = row;
+    texture.in_layer = in_layer;
+}
+
+void GGrid::_SetScrollRegion(int top, int bot, int cols)
+{
+    if (top == _scroll_top && bot == _scroll_bot)
         return;
+
+    // The animation of another region can't be continued
+    _SetScrollOffset(0);
+    _DropScrolledOut();
+
+    _scroll_top = top;
+    _scroll_bot = bot;
+    int width = CalcX(cols);
+    int height = CalcY(bot - top);
+    _grid.move(_scroll_clip, 0, CalcY(top));
+    _scroll_clip.set_size_request(width, height);
+    _scroll_layer.set_size_request(width, height);
+
+    // Rearrange the labels between the grid and the layer
+    for (auto &[_, texture] : _textures)
+        _PlaceLabel(texture, texture.row, false);
+    for (auto &[_, placeholder] : _placeholders)
+        _PlaceLabel(placeholder.second, placeholder.second.row, false);
+}
+
+void GGrid::_StartScroll(int rows)
+{
+    // Pretend the layer is still where it was, and let it slide from there.
+    // A scroll during an animation continues from the current offset.
+    double height = CalcY(_scroll_bot - _scroll_top);
+    _scroll_from = std::clamp(_scroll_offset + CalcY(rows), -height, height);
+    _scroll_start = 0;
+    _SetScrollOffset(_scroll_from);
+
+    if (!_scroll_tick_id)
+    {
+        auto on_tick = [](GtkWidget *, GdkFrameClock *clock, gpointer data) -> gboolean {
+            return reinterpret_cast<GGrid *>(data)->_OnScrollTick(clock);
+        };
+        _scroll_tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(_grid.g_obj()), on_tick, this, nullptr);
     }
-    // Add the label to the migration horde.
-    _labels_positions[label.g_obj()] = new_y;
-    // Make sure the migration is happening in the background.
-    if (-1u == _scroll_timer_id)
-        _scroll_timer_id = _GtkTimer0<&GGrid::_OnMoveLabels>(delay);
-}
-
-void GGrid::_OnMoveLabels()
-{
-    // Move the labels towards their intended positions.
-    for (auto it = _labels_positions.begin(); it != _labels_positions.end(); )
-    {
-        Gtk::Label label{it->first};
-        int new_y = it->second;
-        double x{}, y{};
-        _grid.get_child_position(label, &x, &y);
-        // Either half the distance to the target or the final step whole.
-        int dy = new_y - y;
-        if (dy < -3 || dy > 3)
-            dy /= 2; 
-        _grid.move(label, x, y + dy);
-        if (new_y == y + dy)
-            it = _labels_positions.erase(it);
-        else
-            ++it;
+}
+
+gboolean GGrid::_OnScrollTick(GdkFrameClock *clock)
+{
+    gint64 now = gdk_frame_clock_get_frame_time(clock);
+    if (!_scroll_start)
+        _scroll_start = now;
+
+    // Ease out: quick start, gentle finish, exactly 0 in the end
+    double duration_us = 1000.0 * SCROLL_STEPS * _smooth_scroll_delay;
+    double t = duration_us > 0 ? std::min(1.0, (now - _scroll_start) / duration_us) : 1.0;
+    double k = 1.0 - t;
+    _SetScrollOffset(t < 1.0 ? _scroll_from * k * k * k : 0);
+
+    if (t < 1.0)
+        return G_SOURCE_CONTINUE;
+    _DropScrolledOut();
+    _scroll_tick_id = 0;
+    return G_SOURCE_REMOVE;
+}
+
+bool GGrid::_KeepScrolledOut(const Renderer::ChunkT &chunk, Texture &texture)
+{
+    if (!_scroll_rows || !texture.in_layer)
+        return false;
+    // Where the content of the label would be now
+    int row = texture.row - _scroll_rows;
+    // The line was replaced rather than scrolled out
+    if (row >= _scroll_top && row < _scroll_bot)
+        return false;
+    // The animation never offsets the layer more than the region height
+    int height = _scroll_bot - _scroll_top;
+    if (row < _scroll_top - height || row >= _scroll_bot + height)
+        return false;
+    texture.row = row;
+    _scroll_layer.move(texture.widget, CalcX(texture.col), CalcY(row - _scroll_top));
+    _scrolled_out.emplace_back(chunk, texture);
+    return true;
+}
+
+void GGrid::_ShiftScrolledOut()
+{
+    // The labels that left the region earlier keep going with the content
+    auto scrolled_out = std::move(_scrolled_out);
+    _scrolled_out.clear();
+    for (auto &[chunk, texture] : scrolled_out)
+    {
+        if (!_KeepScrolledOut(chunk, texture))
+            _RemoveTexture(chunk, texture);
+    }
+}
+
+void GGrid::_DropScrolledOut()
+{
+    for (auto &[chunk, texture] : _scrolled_out)
+        _RemoveTexture(chunk, texture);
+    _scrolled_out.clear();
+}
+
+void GGrid::_SetScrollOffset(double offset)
+{
+    if (offset == _scroll_offset)
+        return;
+    _scroll_offset = offset;
+
+    // Only the transform of the layer changes, the labels stay where they are
+    GskTransform *transform = nullptr;
+    if (offset)
+    {
+        graphene_point_t point = GRAPHENE_POINT_INIT(0, static_cast<float>(offset));
+        transform = gsk_transform_translate(nullptr, &point);
+    }
+    gtk_fixed_set_child_transform(GTK_FIXED(_scroll_clip.g_obj()), GTK_WIDGET(_scroll_layer.g_obj()), transform);
+    gsk_transform_unref(transform);
+}
+
+void GGrid::_UpdateRowAges(const Renderer::GridLinesT &grid_lines)
+{
+    _block_rows.resize(grid_lines.size());
+    _row_ages.resize(grid_lines.size());
+    for (size_t row = 0; row < grid_lines.size(); ++row)
+    {
+        if (_block_rows[row] == grid_lines[row])
+        {
+            _row_ages[row] = std::min(_row_ages[row] + 1, std::numeric_limits<int>::max() - 1);
+            continue;
+        }
+        _block_rows[row] = grid_lines[row];
+        _row_ages[row] = 0;
     }
 
-    // If necessary, rearm the timer.
-    _scroll_timer_id = _labels_positions.empty()
-        ? -1u
-        : _GtkTimer0<&GGrid::_OnMoveLabels>(GConfig::GetSmoothScrollDelay());
+    // A change splits the block back into the rows
+    std::erase_if(_blocks, [&](_Block &block) {
+        for (int row = block.top; row < block.bot; ++row)
+        {
+            if (row >= static_cast<int>(_row_ages.size()) || !_row_ages[row])
+            {
+                _DissolveBlock(block);
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+void GGrid::_CoalesceRows(const Renderer::GridLinesT &grid_lines)
+{
+    int frames = _coalesce_frames;
+    if (!frames)
+    {
+        _DissolveBlocks();
+        return;
+    }
+
+    int rowN = grid_lines.size();
+    std::vector<std::vector<Texture *>> row_textures(rowN);
+    for (auto &[_, texture] : _textures)
+    {
+        if (texture.row >= 0 && texture.row < rowN)
+            row_textures[texture.row].push_back(&texture);
+    }
+    // The rows already merged or still waiting for the labels are left alone
+    std::vector<bool> busy(rowN);
+    for (const auto &block : _blocks)
+        std::fill(busy.begin() + block.top, busy.begin() + block.bot, true);
+    for (const auto &[row, _] : _placeholders)
+        if (row < rowN)
+            busy[row] = true;
+
+    auto isStable = [&](int row) {
+        if (busy[row] || _row_ages[row] < frames)
+            return false;
+        const auto &line_row = grid_lines[row];
+        size_t count = line_row ? line_row->chunks.size() + line_row->backgrounds.size() : 0;
+        return row_textures[row].size() == count;
+    };
+    auto inLayer = [&](int row) { return row >= _scroll_top && row < _scroll_bot; };
+
+    for (int top = 0; top < rowN; )
+    {
+        if (!isStable(top))
+        {
+            ++top;
+            continue;
+        }
+        int bot = top + 1;
+        while (bot < rowN && isStable(bot) && inLayer(bot) == inLayer(top))
+            ++bot;
+        if (bot - top >= MIN_BLOCK_ROWS)
+            _CreateBlock(top, bot, row_textures);
+        top = bot;
+    }
+}
+
+void GGrid::_CreateBlock(int top, int bot, const std::vector<std::vector<Texture *>> &row_textures)
+{
+    // All the labels must have been laid out and mapped to take their pictures,
+    // the image of an unmapped widget is empty.
+    size_t count{};
+    for (int row = top; row < bot; ++row)
+    {
+        for (Texture *texture : row_textures[row])
+        {
+            GtkWidget *widget = GTK_WIDGET(texture->widget.g_obj());
+            if (!gtk_widget_get_mapped(widget) || !gtk_widget_get_width(widget) || !gtk_widget_get_height(widget))
+                return;
+            ++count;
+        }
+    }
+    if (!count)
+        return;
+
+    // The current rendering of the labels is recorded, no layout is needed to draw it
+    GtkSnapshot *snapshot = gtk_snapshot_new();
+    float width{};
+    for (int row = top; row < bot; ++row)
+    {
+        for (Texture *texture : row_textures[row])
+        {
+            GtkWidget *widget = GTK_WIDGET(texture->widget.g_obj());
+            int w = gtk_widget_get_width(widget);
+            int h = gtk_widget_get_height(widget);
+            GdkPaintable *live = gtk_widget_paintable_new(widget);
+            GdkPaintable *image = gdk_paintable_get_current_image(live);
+            graphene_point_t offset = GRAPHENE_POINT_INIT(static_cast<float>(CalcX(texture->col)),
+                                                          static_cast<float>(CalcY(row - top)));
+            gtk_snapshot_save(snapshot);
+            gtk_snapshot_translate(snapshot, &offset);
+            gdk_paintable_snapshot(image, snapshot, w, h);
+            gtk_snapshot_restore(snapshot);
+            g_object_unref(image);
+            g_object_unref(live);
+            width = std::max(width, offset.x + w);
+        }
+    }
+    // Whole pixels, so that the picture is never scaled to its allocation
+    // when the cell width is fractional
+    graphene_size_t size = GRAPHENE_SIZE_INIT(std::ceil(width), static_cast<float>(CalcY(bot - top)));
+    GdkPaintable *paintable = gtk_snapshot_free_to_paintable(snapshot, &size);
+    if (!paintable)
+        return;
+
+    Gtk::Widget picture{G_OBJECT(gtk_picture_new_for_paintable(paintable))};
+    g_object_unref(paintable);
+    gtk_picture_set_can_shrink(GTK_PICTURE(picture.g_obj()), false);
+    picture.set_can_focus(false);
+    picture.set_can_target(false);
+
+    bool in_layer = top >= _scroll_top && top < _scroll_bot;
+    auto container = in_layer ? _scroll_layer : _grid;
+    container.put(picture, 0, CalcY(in_layer ? top - _scroll_top : top));
+    // Under the other labels and the cursor
+    gtk_widget_insert_after(GTK_WIDGET(picture.g_obj()), GTK_WIDGET(container.g_obj()), nullptr);
+
+    for (int row = top; row < bot; ++row)
+        for (Texture *texture : row_textures[row])
+            texture->widget.set_visible(false);
+    _blocks.push_back({top, bot, picture, in_layer});
+    Logger().debug("GGrid::_CreateBlock top={} bot={} widgets={}", top, bot, count);
+}
+
+void GGrid::_DissolveBlock(_Block &block)
+{
+    (block.in_layer ? _scroll_layer : _grid).remove(block.picture);
+    for (auto &[_, texture] : _textures)
+    {
+        if (texture.row >= block.top && texture.row < block.bot && texture.in_layer == block.in_layer)
+            texture.widget.set_visible(true);
+    }
+}
+
+void GGrid::_DissolveBlocks()
+{
+    for (auto &block : _blocks)
+        _DissolveBlock(block);
+    _blocks.clear();
 }
 
 std::string GGrid::DumpMarkup()
@@ -554,20 +975,30 @@ std::string GGrid::DumpMarkup()
 
     for (int row = 0, rowN = grid_lines.size(); row < rowN; ++row)
     {
-        const auto &chunk = grid_lines[row];
-        if (!chunk)
+        // The rows drawn as one picture are marked with the extent of the block
+        for (const auto &block : _blocks)
         {
-            oss << "\n";
-            continue;
+            if (row == block.top)
+                oss << fmt::format("{{block {}-{}}}", block.top, block.bot);
         }
-
-        auto it = _textures.find(chunk);
-        if (it == _textures.end())
-            oss << "???\n";
-        else
+        const auto &line_row = grid_lines[row];
+        if (line_row)
         {
-            oss << it->second.label.get_label() << "\n";
+            // The chunks of a row are separated with their columns
+            for (const auto *chunks : {&line_row->backgrounds, &line_row->chunks})
+            for (const auto &chunk : *chunks)
+            {
+                auto it = _textures.find(chunk);
+                oss << "[" << chunk->col << "]";
+                if (it == _textures.end())
+                    oss << "???";
+                else
+                    oss << (chunk->words.empty()
+                            ? fmt::format("bg=#{:06x}", chunk->bg)
+                            : Gtk::Label{it->second.widget.g_obj()}.get_label());
+            }
         }
+        oss << "\n";
     }
 
     return oss.str();
@@ -4,12 +4,16 @@
 #include "IWindow.hpp"
 #include "Utils.hpp"
 #include "GCursor.hpp"
+#include "LruCache.hpp"
+#include "GCallbackAdaptor.hpp"
 
 #include "gir/Owned.hpp"
 #include "Gtk/CssProvider.hpp"
+#include "Gtk/DrawingArea.hpp"
 #include "Gtk/Fixed.hpp"
 #include "Gtk/Label.hpp"
 
+#include <chrono>
 #include <unordered_map>
 
 namespace Gtk = gir::Gtk;
@@ -18,9 +22,11 @@ struct IWindowHandler;
 class GFont;
 
 class GGrid
+    : private GCallbackAdaptor<GGrid>
 {
 public:
     GGrid(Gtk::Fixed grid, GFont &font, Session::AtomicPtrT &session, IWindowHandler *);
+    ~GGrid();
 
     Gtk::StyleProvider& GetStyle()
     {
@@ -30,6 +36,10 @@ public:
     void UpdateStyle(Session *);
     void MeasureCell();
     void Present(int width, int height);
+    // Only the cursor has changed
+    void PresentCursor();
+    // The window focus has changed
+    void SetFocused(bool);
     void Clear();
     void CheckSize(int width, int height);
 
@@ -53,8 +63,6 @@ private:
     Session::AtomicPtrT &_session;
     IWindowHandler *_window_handler;
     gir::Owned<Gtk::CssProvider> _css_provider;
-    std::unordered_map<unsigned, std::string> _pango_styles;
-    std::string _default_pango_style;
 
     double _cell_width{};
     int _cell_height{};
@@ -62,13 +70,54 @@ private:
     struct Texture
     {
         int row{};
-        // Chunk -> non-owned label
-        Gtk::Label label;
+        int col{};
+        // Chunk -> non-owned label, or the background fill
+        Gtk::Widget widget;
+        // The pango styles the label was created with
+        unsigned style_generation{};
+        // The label is in the scroll layer rather than directly in the grid
+        bool in_layer{};
+        // The backgrounds are kept under the text
+        bool is_background{};
     };
     std::unordered_map<Renderer::ChunkT, Texture> _textures;
+    // The outdated labels left in place while the new ones are being created
+    // in the following frames: row -> (chunk, texture)
+    std::unordered_multimap<int, std::pair<Renderer::ChunkT, Texture>> _placeholders;
+
+    // The labels that left the screen recently are kept aside to be reused
+    // if the same content appears again (scrolling back, switching buffers).
+    struct _CacheKey
+    {
+        Renderer::ChunkT chunk;
+        // The labels are only valid for the pango styles they were created with
+        unsigned style_generation{};
+
+        bool operator==(const _CacheKey &o) const
+        {
+            return style_generation == o.style_generation && *chunk == *o.chunk;
+        }
+    };
+    struct _CacheKeyHash
+    {
+        size_t operator()(const _CacheKey &k) const
+        {
+            return k.chunk->Hash() ^ k.style_generation;
+        }
+    };
+    LruCache<_CacheKey, Gtk::Widget, _CacheKeyHash> _label_cache;
+    unsigned _style_generation{};
 
     std::unique_ptr<GCursor> _cursor;
 
+    // The settings needed for every frame are cached, GSettings tells when they change
+    std::vector<gulong> _settings_handlers;
+    std::chrono::milliseconds _frame_budget{};
+    int _smooth_scroll_delay{};
+    int _coalesce_frames{};
+    void _WatchSetting(const char *key);
+    void _OnSettingChanged(GSettings *, gchar *key);
+
     gboolean _OnKeyPressed(guint keyval, guint /*keycode*/, GdkModifierType state);
     void _OnKeyReleased(guint keyval, guint /*keycode*/, GdkModifierType /*state*/);
     // Mark the Alt was pressed, show the menubar when the alt is released without any other key pressed.
@@ -77,25 +126,60 @@ private:
     int _last_rows = 0, _last_cols = 0;
     void _CheckSize(int width, int height, Session *);
     void _UpdateLabels(Session *);
-    void _UpdatePangoStyles(Session *);
-    std::string _MakePangoStyle(const HlAttr &, const HlAttr &def_attr);
-
-
-    // Smooth scrolling
-    std::unordered_map<::GObject*, int> _labels_positions;
-    guint _scroll_timer_id = -1u;
-
-    void _MoveLabel(Gtk::Label, int new_y);
-    void _OnMoveLabels();
-
-    // A generic async pass to the Gtk thread.
-    template <void (GGrid::*func)()>
-    guint _GtkTimer0(int ms)
+    Texture _CreateTexture(int row, const GridLine::Chunk &, const HlTable &);
+    Gtk::Label _CreateLabel(const GridLine::Chunk &, const HlTable &);
+    Gtk::DrawingArea _CreateBackground(const GridLine::Chunk &);
+    void _RemoveTexture(const Renderer::ChunkT &, Texture &);
+    void _UpdateCss(Session *);
+
+
+    // Smooth scrolling: the labels of the scrolled region are kept in a layer,
+    // which is translated as a whole while animating. The layer is clipped
+    // to the region by its parent.
+    Gtk::Fixed _scroll_clip;
+    Gtk::Fixed _scroll_layer;
+    int _scroll_top = 0, _scroll_bot = 0;
+    // The offset of the layer decays from _scroll_from to 0 during the animation
+    double _scroll_from{};
+    double _scroll_offset{};
+    gint64 _scroll_start{};
+    guint _scroll_tick_id{};
+    // The animation takes this many smooth scroll delays
+    static constexpr int SCROLL_STEPS = 8;
+    // The rows scrolled in the frame being presented
+    int _scroll_rows = 0;
+    // The labels that have just left the region are kept in the layer
+    // beyond the clip, so that they slide out instead of leaving a gap.
+    std::vector<std::pair<Renderer::ChunkT, Texture>> _scrolled_out;
+
+    Gtk::Fixed _GetContainer(const Texture &t) { return t.in_layer ? _scroll_layer : _grid; }
+    void _PlaceLabel(Texture &, int row, bool is_new);
+    void _SetScrollRegion(int top, int bot, int cols);
+    void _StartScroll(int rows);
+    bool _KeepScrolledOut(const Renderer::ChunkT &, Texture &);
+    void _ShiftScrolledOut();
+    void _DropScrolledOut();
+    gboolean _OnScrollTick(GdkFrameClock *);
+    void _SetScrollOffset(double);
+
+    // Coalescing: the runs of rows that haven't changed for a while are
+    // drawn as one picture, their labels are hidden meanwhile.
+    struct _Block
     {
-        auto on_timeout = [](gpointer data) -> gboolean {
-            (reinterpret_cast<GGrid *>(data)->*func)();
-            return FALSE;
-        };
-        return g_timeout_add(ms, on_timeout, this);
-    }
+        int top{}, bot{};
+        Gtk::Widget picture;
+        bool in_layer{};
+    };
+    std::vector<_Block> _blocks;
+    // The rows as of the last frame and how many frames they've stayed the same
+    Renderer::GridLinesT _block_rows;
+    std::vector<int> _row_ages;
+    // Blocks are only worth it for this many rows
+    static constexpr int MIN_BLOCK_ROWS = 4;
+
+    void _UpdateRowAges(const Renderer::GridLinesT &);
+    void _CoalesceRows(const Renderer::GridLinesT &);
+    void _CreateBlock(int top, int bot, const std::vector<std::vector<Texture *>> &row_textures);
+    void _DissolveBlock(_Block &);
+    void _DissolveBlocks();
 };
@@ -96,6 +96,8 @@ GWindow::GWindow(const Gtk::Application &app, Session::AtomicPtrT &session)
 
 GWindow::~GWindow()
 {
+    if (_tick_id)
+        gtk_widget_remove_tick_callback(GTK_WIDGET(_window.g_obj()), _tick_id);
     _window.destroy();
 }
 
@@ -145,6 +147,13 @@ void GWindow::_SetupWindowSignals()
     g_signal_connect(_window.g_obj(), "notify::default-width", G_CALLBACK(sizeChanged), this);
     g_signal_connect(_window.g_obj(), "notify::default-height", G_CALLBACK(sizeChanged), this);
 
+    using ActiveChangedT = void (*)(GObject *, GParamSpec *, gpointer data);
+    ActiveChangedT activeChanged = [](GObject *window, GParamSpec *, gpointer data) {
+        auto self = reinterpret_cast<GWindow *>(data);
+        self->_grid->SetFocused(gtk_window_is_active(GTK_WINDOW(window)));
+    };
+    g_signal_connect(_window.g_obj(), "notify::is-active", G_CALLBACK(activeChanged), this);
+
     _window.on_show(_window, [this](auto) { CheckSizeAsync(); });
 
     _window.on_close_request(_window, [this](auto) -> gboolean {
@@ -169,7 +178,7 @@ void GWindow::_SetupStatusLabel()
 
 void GWindow::CheckSizeAsync()
 {
-    _GtkTimer0<&GWindow::_CheckSize>(1);
+    _exec.Post(Executor::RESIZE, [this] { _CheckSize(); });
 }
 
 void GWindow::_CheckSize()
@@ -181,7 +190,30 @@ void GWindow::_CheckSize()
 
 void GWindow::Present()
 {
-    _GtkTimer(1, [this]() { _Present(); });
+    // A present is already pending, it will render the latest state anyway
+    if (_present_pending.exchange(true))
+        return;
+    _exec.Post(Executor::PRESENT, [this] { _SchedulePresent(); });
+}
+
+void GWindow::_SchedulePresent()
+{
+    if (_tick_id)
+        return;
+    _tick_id = gtk_widget_add_tick_callback(GTK_WIDGET(_window.g_obj()),
+            MakeCallback<&GWindow::_OnTick>(), this, nullptr);
+}
+
+gboolean GWindow::_OnTick(GtkWidget *, GdkFrameClock *)
+{
+    if (!_present_pending.exchange(false))
+    {
+        // Nothing to present, let the frame clock idle
+        _tick_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    _Present();
+    return G_SOURCE_CONTINUE;
 }
 
 void GWindow::_Present()
@@ -191,9 +223,28 @@ void GWindow::_Present()
     _grid->Present(width, height);
 }
 
+void GWindow::PresentCursor()
+{
+    // The pending present of the grid updates the cursor too
+    if (_present_pending)
+        return;
+    if (_cursor_pending.exchange(true))
+        return;
+    _exec.Post(Executor::PRESENT, [this] { _PresentCursor(); });
+}
+
+void GWindow::_PresentCursor()
+{
+    _cursor_pending = false;
+    // The grid may have been modified since the cursor was posted
+    if (_present_pending)
+        return;
+    _grid->PresentCursor();
+}
+
 void GWindow::SessionEnd()
 {
-    _GtkTimer0<&GWindow::_SessionEnd>(1);
+    _exec.Post(Executor::HOUSEKEEPING, [this] { _SessionEnd(); });
 }
 
 void GWindow::_SessionEnd()
@@ -456,7 +507,7 @@ void GWindow::_OnSettingsAction(GSimpleAction *, GVariant *)
 
 void GWindow::SetGuiFont(const std::string &value)
 {
-    _GtkTimer(1, [this, value]() {
+    _exec.Post(Executor::HOUSEKEEPING, [this, value] {
         _font->SetGuiFont(value);
     });
 }
@@ -7,6 +7,7 @@
 #include "GFont.hpp"
 #include "IWindowHandler.hpp"
 #include "GCallbackAdaptor.hpp"
+#include "GExec.hpp"
 
 #include "Gtk/Application.hpp"
 #include "Gtk/Window.hpp"
@@ -15,6 +16,7 @@
 
 #include <string>
 #include <memory>
+#include <atomic>
 #include <gtk/gtk.h>
 
 
@@ -34,6 +36,7 @@ public:
     ~GWindow();
 
     void Present() override;
+    void PresentCursor() override;
     void DrawCursor(cairo_t *, int row, int col, unsigned fg, std::string_view mode);
     void SessionEnd() override;
 
@@ -43,6 +46,8 @@ public:
 private:
     Gtk::Application _app;
     Session::AtomicPtrT &_session;
+    // The tasks passed from the other threads
+    GExec _exec;
 
     gir::Owned<Gtk::Builder> _builder;
     Gtk::Window _window;
@@ -57,9 +62,19 @@ private:
     void _UpdateTitle();
 
     void CheckSizeAsync() override;
+    void PresentAsync() override { Present(); }
     void _CheckSize();
 
+    // Presents are coalesced: the latest frame is rendered on the next
+    // frame clock tick, the superseded ones are skipped altogether.
+    std::atomic<bool> _present_pending{false};
+    guint _tick_id = 0;
+    void _SchedulePresent();
+    gboolean _OnTick(GtkWidget *, GdkFrameClock *);
     void _Present();
+    // The cursor is presented separately when the grid hasn't changed
+    std::atomic<bool> _cursor_pending{false};
+    void _PresentCursor();
     void _SessionEnd();
 
     void MenuBarToggle() override;
@@ -76,28 +91,4 @@ private:
     void _OnDisconnectAction(GSimpleAction *, GVariant *);
     void _OnSettingsAction(GSimpleAction *, GVariant *);
     void _OnShowMarkupAction(GSimpleAction *, GVariant *);
-
-
-    // A generic async pass to the Gtk thread.
-    template <void (GWindow::*func)()>
-    void _GtkTimer0(int ms)
-    {
-        auto on_timeout = [](gpointer data) -> gboolean {
-            (reinterpret_cast<GWindow *>(data)->*func)();
-            return FALSE;
-        };
-        g_timeout_add(ms, on_timeout, this);
-    }
-
-    static void _GtkTimer(int ms, std::function<void(void)> func)
-    {
-        using FuncT = decltype(func);
-        FuncT *boxed_func = new FuncT{func};
-        auto on_timeout = [](gpointer data) {
-            std::unique_ptr<FuncT> f{reinterpret_cast<FuncT*>(data)};
-            (*f.get())();
-            return FALSE;
-        };
-        g_timeout_add(ms, on_timeout, boxed_func);
-    }
 };
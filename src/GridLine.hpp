@@ -1,17 +1,29 @@
 #pragma once
 
+#include "SlabPool.hpp"
+
+#include <algorithm>
 #include <compare>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
+#include <functional>
 
 class GridLine
 {
 public:
+    // The rows are rebuilt on every change, so their pieces come from the slab pool
+    using TextT = std::basic_string<char, std::char_traits<char>, SlabAllocator<char>>;
+
     struct Word
     {
-        unsigned hl_id = 0;
-        std::string text;
+        // The text class of the highlighting, see HlTable
+        unsigned text_class = 0;
+        TextT text;
+        // The column of the first cell in the row
+        int col = 0;
 
         auto operator<=>(const Word &) const = default;
 
@@ -21,14 +33,18 @@ public:
         }
     };
 
+    // A piece of a row shaped as a whole
     struct Chunk
     {
         using PtrT = std::shared_ptr<Chunk>;
 
+        int col = 0; // the first column in the row
         int width = 0; // count of cells
 
-        using WordsT = std::vector<Word>;
+        using WordsT = std::vector<Word, SlabAllocator<Word>>;
         WordsT words;
+        // A chunk without words is a solid fill of the cells with this color
+        uint32_t bg = 0;
 
         Chunk(int width, WordsT &&words)
             : width{width}
@@ -37,5 +53,43 @@ public:
         }
 
         auto operator<=>(const Chunk &) const = default;
+
+        int GetEnd() const { return col + width; }
+
+        // Hash of the content to find equal chunks
+        size_t Hash() const
+        {
+            size_t h = std::hash<int>{}(col) * 31 + std::hash<int>{}(width);
+            h = h * 31 + std::hash<uint32_t>{}(bg);
+            for (const auto &word : words)
+            {
+                h = h * 31 + std::hash<unsigned>{}(word.text_class);
+                h = h * 31 + std::hash<std::string_view>{}(word.text);
+            }
+            return h;
+        }
+    };
+
+    // A row is split into the chunks at the runs of spaces, so that a change
+    // only reshapes the chunk it's in. The runs of plain spaces are left out,
+    // the backgrounds are filled separately under the text.
+    struct Row
+    {
+        using PtrT = std::shared_ptr<Row>;
+        using ChunksT = std::vector<Chunk::PtrT, SlabAllocator<Chunk::PtrT>>;
+
+        ChunksT chunks;
+        // The runs of cells with the same non-default background
+        ChunksT backgrounds;
+
+        // Compare the content rather than the identity of the chunks
+        bool operator==(const Row &o) const
+        {
+            auto equal = [](const ChunksT &a, const ChunksT &b) {
+                return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                                  [](const Chunk::PtrT &a, const Chunk::PtrT &b) { return *a == *b; });
+            };
+            return equal(chunks, o.chunks) && equal(backgrounds, o.backgrounds);
+        }
     };
 };
@@ -2,7 +2,7 @@
 
 #include <optional>
 #include <cstdint>
-#include <unordered_map>
+#include <functional>
 
 struct HlAttr
 {
@@ -23,6 +23,17 @@ struct HlAttr
     std::optional<uint32_t> fg, bg;
     unsigned flags = 0;
     std::optional<uint32_t> special{};
+    // The transparency in percent, only the cursor uses it
+    unsigned blend = 0;
 
-    using MapT = std::unordered_map<unsigned, HlAttr>;
+    bool operator==(const HlAttr &) const = default;
+
+    struct Hash
+    {
+        size_t operator()(const HlAttr &a) const
+        {
+            std::hash<std::optional<uint32_t>> h;
+            return (((h(a.fg) * 31 + h(a.bg)) * 31 + h(a.special)) * 31 + a.flags) * 31 + a.blend;
+        }
+    };
 };
@@ -0,0 +1,175 @@
+#include "HlTable.hpp"
+
+#include <fmt/format.h>
+
+
+HlTable::HlTable()
+{
+    // Default hightlight attributes
+    _def_attr.fg = 0xffffff;
+    _def_attr.bg = 0;
+
+    // The class 0 is the default highlighting
+    _entries.push_back(Entry{});
+    _class_index[HlAttr{}] = 0;
+    _Resolve(_entries[0]);
+}
+
+bool HlTable::Define(unsigned hl_id, const HlAttr &attr)
+{
+    // Find the class of the visually identical highlighting or start a new one
+    auto [it, inserted] = _class_index.try_emplace(attr, _entries.size());
+    if (inserted)
+    {
+        _entries.push_back(Entry{.attr = attr, .pango_style = {}});
+        _Resolve(_entries.back());
+    }
+    unsigned hl_class = it->second;
+
+    if (hl_id >= _hl_class.size())
+    {
+        _hl_class.resize(hl_id + 1, 0);
+        _hl_text_class.resize(hl_id + 1, 0);
+    }
+    if (_hl_class[hl_id] == hl_class)
+        return false;
+    _hl_class[hl_id] = hl_class;
+    _hl_text_class[hl_id] = _entries[hl_class].text_class;
+    return true;
+}
+
+bool HlTable::SetDefault(uint32_t fg, uint32_t bg)
+{
+    if (_def_attr.fg == fg && _def_attr.bg == bg)
+        return false;
+    _def_attr.fg = fg;
+    _def_attr.bg = bg;
+    for (auto &entry : _entries)
+        _Resolve(entry);
+    _UpdateTextClasses();
+    return true;
+}
+
+void HlTable::_UpdateTextClasses()
+{
+    for (size_t hl_id = 0; hl_id < _hl_class.size(); ++hl_id)
+        _hl_text_class[hl_id] = _entries[_hl_class[hl_id]].text_class;
+}
+
+bool HlTable::_IsWasteful() const
+{
+    std::vector<bool> class_used(_entries.size());
+    std::vector<bool> text_used(_texts.size());
+    class_used[0] = true;
+    for (auto hl_class : _hl_class)
+        class_used[hl_class] = true;
+    size_t classes{}, texts{};
+    for (size_t hl_class = 0; hl_class < _entries.size(); ++hl_class)
+    {
+        if (!class_used[hl_class])
+            continue;
+        ++classes;
+        unsigned text_class = _entries[hl_class].text_class;
+        if (!text_used[text_class])
+        {
+            text_used[text_class] = true;
+            ++texts;
+        }
+    }
+    return 2 * classes < _entries.size() || 2 * texts < _texts.size();
+}
+
+bool HlTable::Compact()
+{
+    if (!_IsWasteful())
+        return false;
+
+    // Rebuild the classes from the highlight ids in use
+    auto entries = std::move(_entries);
+    _entries.clear();
+    _class_index.clear();
+    _texts.clear();
+    _text_index.clear();
+
+    // The text class 0 is the default one again
+    _entries.push_back(Entry{});
+    _class_index[HlAttr{}] = 0;
+    _Resolve(_entries[0]);
+
+    // old class -> new class
+    std::vector<unsigned> renumber(entries.size(), 0);
+    std::vector<bool> renumbered(entries.size());
+    renumbered[0] = true;
+    for (auto &hl_class : _hl_class)
+    {
+        if (!renumbered[hl_class])
+        {
+            renumbered[hl_class] = true;
+            renumber[hl_class] = _entries.size();
+            _class_index[entries[hl_class].attr] = _entries.size();
+            _entries.push_back(Entry{.attr = entries[hl_class].attr, .pango_style = {}});
+            _Resolve(_entries.back());
+        }
+        hl_class = renumber[hl_class];
+    }
+    _UpdateTextClasses();
+    return true;
+}
+
+void HlTable::_Resolve(Entry &entry)
+{
+    const auto &attr = entry.attr;
+    uint32_t def_fg = _def_attr.fg.value();
+    uint32_t def_bg = _def_attr.bg.value();
+    bool reverse = attr.flags & HlAttr::F_REVERSE;
+
+    entry.fg = attr.fg.value_or(def_fg);
+    entry.bg = attr.bg.value_or(def_bg);
+    if (reverse)
+        std::swap(entry.fg, entry.bg);
+    entry.special = attr.special.value_or(entry.fg);
+
+    entry.bits = 0;
+    if (attr.flags & (HlAttr::F_TEXT_DECORATION | HlAttr::F_STRIKETHROUGH))
+        entry.bits |= Entry::B_DECORATION;
+    if (!reverse && entry.bg == def_bg && !entry.HasDecoration())
+        entry.bits |= Entry::B_INVISIBLE_SPACE;
+    if (reverse || attr.bg.has_value())
+        entry.bits |= Entry::B_DEPENDS_ON_DEFAULT;
+
+    // The colors that aren't set explicitly are inherited from the CSS
+    std::string &style = entry.pango_style;
+    style.clear();
+    if (reverse)
+        style += fmt::format(" color=\"#{:06x}\"", entry.fg);
+    else if (attr.fg.has_value())
+        style += fmt::format(" color=\"#{:06x}\"", attr.fg.value());
+    if ((attr.flags & HlAttr::F_ITALIC))
+        style += " style=\"italic\"";
+    if ((attr.flags & HlAttr::F_BOLD))
+        style += " weight=\"bold\"";
+
+    if ((attr.flags & HlAttr::F_TEXT_DECORATION))
+    {
+        if ((attr.flags & HlAttr::F_UNDERUNDERLINE))
+            style += " underline=\"single\"";
+        else if ((attr.flags & HlAttr::F_UNDERCURL))
+            style += " underline=\"error\"";
+        //else if ((attr.flags & HlAttr::F_UNDERDASH))
+        //    style = "dashed";
+        //else if ((attr.flags & HlAttr::F_UNDERDOT))
+        //    style = "dotted";
+        if (attr.special.has_value())
+            style += fmt::format(" underline_color=\"#{:06x}\"", attr.special.value());
+    }
+    else if ((attr.flags & HlAttr::F_STRIKETHROUGH))
+    {
+        style += " strikethrough=\"true\"";
+    }
+
+    // Find the text class of the same text rendering or start a new one
+    auto [it, inserted] = _text_index.try_emplace({style, entry.HasDecoration()}, _texts.size());
+    if (inserted)
+        _texts.push_back(TextEntry{style, entry.HasDecoration()});
+    entry.text_class = it->second;
+}
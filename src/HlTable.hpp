@@ -0,0 +1,109 @@
+#pragma once
+
+#include "HlAttr.hpp"
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+#include <map>
+#include <utility>
+
+// The highlighting table: hl_id -> class -> precomputed rendering properties.
+// Visually identical highlight ids share the same class, and everything
+// needed to render a class is prepared when it's defined, so that
+// the lookups while rendering are just array indexing.
+class HlTable
+{
+public:
+    struct Entry
+    {
+        HlAttr attr;
+
+        // The resolved colors: defaults applied, reverse folded in
+        uint32_t fg{};
+        uint32_t bg{};
+        uint32_t special{};
+
+        enum Bits : uint8_t
+        {
+            // Spaces with this highlighting look exactly like empty grid
+            B_INVISIBLE_SPACE = 1 << 0,
+            // Underline, undercurl, strikethrough etc
+            B_DECORATION = 1 << 1,
+            // The rendering changes when the default colors change
+            B_DEPENDS_ON_DEFAULT = 1 << 2,
+        };
+        uint8_t bits{};
+
+        // Pango span attributes, like ` color="#ff0000" weight="bold"`.
+        // The background is painted separately from the text.
+        std::string pango_style;
+        // The classes rendering the text the same way share the text class
+        unsigned text_class{};
+
+        bool IsSpaceInvisible() const { return bits & B_INVISIBLE_SPACE; }
+        bool HasDecoration() const { return bits & B_DECORATION; }
+        bool DependsOnDefault() const { return bits & B_DEPENDS_ON_DEFAULT; }
+    };
+
+    HlTable();
+
+    // Define the highlighting for the hl_id, return true if its class has changed.
+    bool Define(unsigned hl_id, const HlAttr &);
+    // Set the default colors, return true if they have actually changed.
+    bool SetDefault(uint32_t fg, uint32_t bg);
+    // Drop the classes nobody refers to anymore if they take the most of the table.
+    // Return true if the classes have been renumbered: whatever keeps the old
+    // text classes has to be rebuilt then.
+    bool Compact();
+
+    const HlAttr& GetDefAttr() const { return _def_attr; }
+    uint32_t GetDefFg() const { return _def_attr.fg.value(); }
+    uint32_t GetDefBg() const { return _def_attr.bg.value(); }
+
+    // The class of the highlighting, the class 0 is the default highlighting.
+    unsigned GetClass(unsigned hl_id) const
+    {
+        return hl_id < _hl_class.size() ? _hl_class[hl_id] : 0;
+    }
+    // hl_id -> class
+    const std::vector<unsigned>& GetClasses() const { return _hl_class; }
+    size_t GetIdCount() const { return _hl_class.size(); }
+
+    // class -> rendering properties
+    const Entry& operator[](unsigned hl_class) const { return _entries[hl_class]; }
+    size_t GetClassCount() const { return _entries.size(); }
+
+    // The text rendering regardless of the background
+    struct TextEntry
+    {
+        std::string pango_style;
+        bool has_decoration{};
+    };
+
+    // The text class of the highlighting, the text class 0 is the default one.
+    unsigned GetTextClass(unsigned hl_id) const
+    {
+        return hl_id < _hl_text_class.size() ? _hl_text_class[hl_id] : 0;
+    }
+    // hl_id -> text class
+    const std::vector<unsigned>& GetTextClasses() const { return _hl_text_class; }
+    // text class -> text rendering properties
+    const TextEntry& GetText(unsigned text_class) const { return _texts[text_class]; }
+
+private:
+    HlAttr _def_attr;
+    std::vector<unsigned> _hl_class;
+    std::vector<Entry> _entries;
+    std::unordered_map<HlAttr, unsigned, HlAttr::Hash> _class_index;
+    std::vector<unsigned> _hl_text_class;
+    std::vector<TextEntry> _texts;
+    std::map<std::pair<std::string, bool>, unsigned> _text_index;
+
+    void _Resolve(Entry &);
+    void _UpdateTextClasses();
+    // Nobody refers to the classes of the replaced definitions and to the text
+    // classes of the previous default colors, but they stay in the table.
+    bool _IsWasteful() const;
+};
@@ -8,6 +8,8 @@ struct IWindow
     virtual ~IWindow() = default;
 
     virtual void Present() = 0;
+    // Only the cursor has changed since the last present
+    virtual void PresentCursor() = 0;
     virtual void SessionEnd() = 0;
     virtual void SetError(const char *) = 0;
     virtual void SetGuiFont(const std::string &) = 0;
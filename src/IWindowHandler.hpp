@@ -6,4 +6,6 @@ struct IWindowHandler
     virtual void MenuBarToggle() = 0;
     virtual void MenuBarHide() = 0;
     virtual void CheckSizeAsync() = 0;
+    // Request one more frame to be presented
+    virtual void PresentAsync() = 0;
 };
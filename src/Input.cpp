@@ -3,35 +3,33 @@
 #include "Logger.hpp"
 
 
-Input::Input(uv_loop_t *loop, MsgPackRpc *rpc)
+Input::Input(AsyncExec &exec, MsgPackRpc *rpc)
     : _rpc{rpc}
-    , _available{loop}
+    , _exec{exec}
 {
 }
 
-void Input::_OnInput()
+Coroutine Input::_OnInput()
 {
-    std::lock_guard<std::mutex> guard{_mutex};
-    std::string input{std::move(_input)};
+    std::string input;
+    {
+        std::lock_guard<std::mutex> guard{_mutex};
+        input = std::move(_input);
+        _input.clear();
+    }
     size_t input_size = input.size();
-    _rpc->Request(
-        [&](MsgPackRpc::PackerT &pk) {
-            pk.pack("nvim_input");
-            pk.pack_array(1);
-            pk.pack(input);
-        },
-        [input_size](const msgpack::object &err, const msgpack::object &resp) {
-            if (!err.is_nil())
-            {
-                std::ostringstream oss;
-                oss << "Input error: " << err;
-                throw std::runtime_error(oss.str());
-            }
-            size_t consumed = resp.as<size_t>();
-            if (consumed < input_size)
-                Logger().warn("[input] Consumed {}/{} bytes", consumed, input_size);
-        }
-    );
+    auto res = co_await _rpc->Call("nvim_input", input);
+    if (!res.err.is_nil())
+    {
+        // The input is lost, but the session can go on
+        std::ostringstream oss;
+        oss << res.err;
+        Logger().error("Input error: {}", oss.str());
+        co_return;
+    }
+    size_t consumed = res.result.as<size_t>();
+    if (consumed < input_size)
+        Logger().warn("[input] Consumed {}/{} bytes", consumed, input_size);
 }
 
 void Input::Accept(std::string_view input)
@@ -40,5 +38,5 @@ void Input::Accept(std::string_view input)
         std::lock_guard<std::mutex> guard{_mutex};
         _input += input;
     }
-    _available.Post([this] { _OnInput(); });
+    _exec.Post(Executor::INPUT, [this] { _OnInput(); });
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "AsyncExec.hpp"
+#include "Coroutine.hpp"
 #include <string>
 #include <mutex>
 #include <uv.h>
@@ -10,16 +11,16 @@ class MsgPackRpc;
 class Input
 {
 public:
-    Input(uv_loop_t *, MsgPackRpc *);
+    Input(AsyncExec &, MsgPackRpc *);
 
     // Feed input keys
     void Accept(std::string_view input);
 
 private:
     MsgPackRpc *_rpc;
-    AsyncExec _available;
+    AsyncExec &_exec;
     std::string _input;
     std::mutex _mutex;
 
-    void _OnInput();
+    Coroutine _OnInput();
 };
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <optional>
+#include <functional>
+
+// A bounded least-recently-used cache. The evicted values are passed
+// to the eviction callback to release their resources.
+template <typename K, typename V, typename Hash = std::hash<K>, typename Eq = std::equal_to<K>>
+class LruCache
+{
+public:
+    using OnEvictT = std::function<void(V &)>;
+
+    LruCache(size_t capacity, OnEvictT on_evict)
+        : _capacity{capacity}
+        , _on_evict{on_evict}
+    {
+    }
+
+    ~LruCache()
+    {
+        Clear();
+    }
+
+    size_t GetSize() const { return _items.size(); }
+    size_t GetCapacity() const { return _capacity; }
+
+    void SetCapacity(size_t capacity)
+    {
+        _capacity = capacity;
+        _Shrink();
+    }
+
+    // Store the value as the most recently used one.
+    void Put(const K &key, V value)
+    {
+        auto it = _index.find(key);
+        if (it != _index.end())
+        {
+            _on_evict(it->second->second);
+            _items.erase(it->second);
+            _index.erase(it);
+        }
+        _items.emplace_front(key, std::move(value));
+        _index.emplace(key, _items.begin());
+        _Shrink();
+    }
+
+    // Extract the value from the cache if present.
+    std::optional<V> Take(const K &key)
+    {
+        auto it = _index.find(key);
+        if (it == _index.end())
+            return {};
+        std::optional<V> value{std::move(it->second->second)};
+        _items.erase(it->second);
+        _index.erase(it);
+        return value;
+    }
+
+    void Clear()
+    {
+        for (auto &item : _items)
+            _on_evict(item.second);
+        _items.clear();
+        _index.clear();
+    }
+
+private:
+    size_t _capacity;
+    OnEvictT _on_evict;
+
+    using _ItemsT = std::list<std::pair<K, V>>;
+    _ItemsT _items;
+    std::unordered_map<K, typename _ItemsT::iterator, Hash, Eq> _index;
+
+    void _Shrink()
+    {
+        while (_items.size() > _capacity)
+        {
+            auto &back = _items.back();
+            _index.erase(back.first);
+            _on_evict(back.second);
+            _items.pop_back();
+        }
+    }
+};
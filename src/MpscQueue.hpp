@@ -0,0 +1,101 @@
+#pragma once
+
+#include "SlabPool.hpp"
+
+#include <atomic>
+#include <utility>
+
+// An unbounded lock-free queue with many producers and a single consumer
+// (the intrusive node queue by D. Vyukov). Pushing is a single atomic exchange,
+// popping doesn't wait for the producers: an element being pushed just now
+// may be missed, it's going to be found by the next pop. The nodes come
+// from the slab pool, so the steady state doesn't touch the heap.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : _head{&_stub}
+        , _tail{&_stub}
+    {
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue& operator=(const MpscQueue &) = delete;
+
+    ~MpscQueue()
+    {
+        T value;
+        while (TryPop(value))
+            ;
+    }
+
+    // Any thread
+    void Push(T value)
+    {
+        _Push(new _Node{{}, std::move(value)});
+    }
+
+    // The consumer thread only
+    bool TryPop(T &value)
+    {
+        _Node *tail = _tail;
+        _Node *next = tail->next.load(std::memory_order_acquire);
+        if (tail == &_stub)
+        {
+            if (!next)
+                return false;
+            _tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (!next)
+        {
+            // The last node can't be taken until there's something after it.
+            if (tail != _head.load(std::memory_order_acquire))
+                return false;  // A producer is in the middle of a push
+            _Push(&_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (!next)
+                return false;
+        }
+        _tail = next;
+        value = std::move(tail->value);
+        delete tail;
+        return true;
+    }
+
+private:
+    struct _Node
+    {
+        std::atomic<_Node *> next{nullptr};
+        T value;
+
+        // A node per push, the slab pool recycles them
+        static void* operator new(size_t size)
+        {
+            if (size <= SlabPool::MAX_BLOCK_SIZE)
+                return SlabPool::Shared().Allocate(size);
+            return ::operator new(size);
+        }
+
+        static void operator delete(void *p, size_t size)
+        {
+            if (size <= SlabPool::MAX_BLOCK_SIZE)
+                SlabPool::Shared().Deallocate(p, size);
+            else
+                ::operator delete(p);
+        }
+    };
+
+    std::atomic<_Node *> _head;
+    _Node *_tail;
+    _Node _stub;
+
+    void _Push(_Node *node)
+    {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        _Node *prev = _head.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+};
@@ -1,6 +1,12 @@
 #include "MsgPackRpc.hpp"
 #include "Logger.hpp"
 #include <iostream>
+#include <algorithm>
+
+struct MsgPackRpc::_Write : uv_write_t
+{
+    msgpack::sbuffer buffer;
+};
 
 
 MsgPackRpc::MsgPackRpc(uv_stream_t *stdin_stream, uv_stream_t *stdout_stream,
@@ -8,9 +14,16 @@ MsgPackRpc::MsgPackRpc(uv_stream_t *stdin_stream, uv_stream_t *stdout_stream,
     : _stdin_stream{stdin_stream}
     , _stdout_stream{stdout_stream}
     , _on_error{on_error}
+    , _pending(INITIAL_PENDING)
+    , _timeout_timer{_stdin_stream->loop}
+    , _flush_idle{new uv_idle_t}
 {
     _stdout_stream->data = this;
 
+    if (int err = uv_idle_init(_stdin_stream->loop, _flush_idle.get()))
+        throw std::runtime_error(fmt::format("Failed to init idle: {}", uv_strerror(err)));
+    _flush_idle->data = this;
+
     auto alloc_buffer = [](uv_handle_t *handle, size_t len, uv_buf_t *buf) {
         MsgPackRpc *self = reinterpret_cast<MsgPackRpc*>(handle->data);
         self->_unp.reserve_buffer(len);
@@ -35,44 +48,247 @@ MsgPackRpc::MsgPackRpc(uv_stream_t *stdin_stream, uv_stream_t *stdout_stream,
 
 MsgPackRpc::~MsgPackRpc()
 {
+    if (_stats.completed)
+    {
+        auto avg = _stats.total_latency / _stats.completed;
+        Logger().info("Requests: completed={} timed_out={} in_flight={} max_in_flight={} avg_latency={}us max_latency={}us",
+                      _stats.completed, _stats.timed_out, _stats.in_flight, _stats.max_in_flight,
+                      std::chrono::duration_cast<std::chrono::microseconds>(avg).count(),
+                      std::chrono::duration_cast<std::chrono::microseconds>(_stats.max_latency).count());
+    }
+    _Flush();
+    // The unfinished writes are going to delete themselves
+    for (auto *w : _writes_in_flight)
+        w->data = nullptr;
+    auto on_close = [](uv_handle_t *h) {
+        delete reinterpret_cast<uv_idle_t *>(h);
+    };
+    uv_close(reinterpret_cast<uv_handle_t *>(_flush_idle.release()), on_close);
+
     if (int err = ::uv_read_stop(_stdout_stream))
         Logger().error(fmt::format("Failed to stop uv read: {}", uv_strerror(err)));
 }
 
 void MsgPackRpc::Request(PackRequestT pack_request, OnResponseT on_response)
 {
-    auto [it, _] = _requests.emplace(_seq++, std::move(on_response));
+    uint32_t seq = _seq++;
+    _AddPending(seq, std::move(on_response));
+    PackerT pk(&_BeginRequest(seq));
+    pack_request(pk);
+    _EndRequest();
+}
+
+void MsgPackRpc::SetTimeout(std::chrono::milliseconds timeout)
+{
+    _timeout = timeout;
+    if (_stats.in_flight)
+        _StartTimeoutTimer();
+}
+
+void MsgPackRpc::_AddPending(uint32_t seq, OnResponseT on_response)
+{
+    while (_pending[seq % _pending.size()].in_use)
+        _GrowPending();
+    auto &pending = _pending[seq % _pending.size()];
+    pending.seq = seq;
+    pending.in_use = true;
+    pending.on_response = std::move(on_response);
+    pending.sent = ClockT::now();
 
-    struct Write : uv_write_t
+    if (!_stats.in_flight++)
+        _StartTimeoutTimer();
+    _stats.max_in_flight = std::max(_stats.max_in_flight, _stats.in_flight);
+}
+
+void MsgPackRpc::_GrowPending()
+{
+    // The pending requests differ modulo the old size, so they differ modulo the new one.
+    std::vector<_Pending> pending(2 * _pending.size());
+    for (auto &p : _pending)
     {
-        msgpack::sbuffer buffer;
-    };
-    std::unique_ptr<Write> w{new Write};
+        if (p.in_use)
+            pending[p.seq % pending.size()] = std::move(p);
+    }
+    _pending.swap(pending);
+}
+
+void MsgPackRpc::_Complete(uint32_t seq, const msgpack::object &err, const msgpack::object &result)
+{
+    auto &pending = _pending[seq % _pending.size()];
+    if (!pending.in_use || pending.seq != seq)
+    {
+        Logger().warn("Response to an unknown request {}", seq);
+        return;
+    }
+    auto latency = ClockT::now() - pending.sent;
+    ++_stats.completed;
+    _stats.total_latency += latency;
+    _stats.max_latency = std::max(_stats.max_latency, latency);
+
+    OnResponseT on_response{_TakePending(pending)};
+    if (on_response)
+        on_response(err, result);
+}
+
+MsgPackRpc::OnResponseT MsgPackRpc::_TakePending(_Pending &pending)
+{
+    // Free the slot first: the handler may send more requests.
+    OnResponseT on_response{std::move(pending.on_response)};
+    pending.on_response = nullptr;
+    pending.in_use = false;
+    if (!--_stats.in_flight)
+        _timeout_timer.Stop();
+    return on_response;
+}
+
+void MsgPackRpc::_Cancel(uint32_t seq)
+{
+    auto &pending = _pending[seq % _pending.size()];
+    if (pending.in_use && pending.seq == seq)
+        pending.on_response = nullptr;
+}
 
+void MsgPackRpc::_StartTimeoutTimer()
+{
+    // Check often enough for the timeout to be noticed in time
+    int period = std::min(_timeout, std::chrono::milliseconds{1000}).count();
+    _timeout_timer.Start(period, period, [this] { _CheckTimeouts(); });
+}
+
+void MsgPackRpc::_CheckTimeouts()
+{
+    auto now = ClockT::now();
+    // The handlers may send more requests and grow the ring,
+    // so the expired requests are found first.
+    std::vector<uint32_t> timed_out;
+    for (const auto &p : _pending)
+    {
+        if (p.in_use && now - p.sent >= _timeout)
+            timed_out.push_back(p.seq);
+    }
+    std::sort(timed_out.begin(), timed_out.end());
+
+    // The callers get an error response, the session goes on.
+    for (uint32_t seq : timed_out)
+    {
+        auto &pending = _pending[seq % _pending.size()];
+        if (!pending.in_use || pending.seq != seq)
+            continue;
+        Logger().error("Request {} timed out", seq);
+        ++_stats.timed_out;
+        OnResponseT on_response{_TakePending(pending)};
+        if (on_response)
+            on_response(msgpack::object{TIMEOUT_ERROR}, msgpack::object{});
+    }
+}
+
+msgpack::sbuffer& MsgPackRpc::_BeginRequest(uint32_t seq)
+{
     // serializes multiple objects using msgpack::packer.
-    msgpack::packer<msgpack::sbuffer> pk(&w->buffer);
+    PackerT pk(&_out);
     pk.pack_array(4);
     pk.pack(0);
-    pk.pack(it->first);
-    pack_request(pk);
+    pk.pack(seq);
+    return _out;
+}
+
+void MsgPackRpc::_EndRequest()
+{
+    // The idle handle keeps the loop from blocking in poll until it's flushed.
+    auto on_idle = [](uv_idle_t *h) {
+        reinterpret_cast<MsgPackRpc *>(h->data)->_Flush();
+    };
+    if (int err = uv_idle_start(_flush_idle.get(), on_idle))
+        throw std::runtime_error(fmt::format("Failed to start idle: {}", uv_strerror(err)));
+}
+
+void MsgPackRpc::_Flush()
+{
+    uv_idle_stop(_flush_idle.get());
+    if (!_out.size())
+        return;
+
+    std::unique_ptr<_Write> w;
+    if (_free_writes.empty())
+        w.reset(new _Write);
+    else
+    {
+        w = std::move(_free_writes.back());
+        _free_writes.pop_back();
+    }
+    w->data = this;
+    // The write takes the packed requests, the next ones go to its old buffer.
+    std::swap(w->buffer, _out);
 
     auto cb = [](uv_write_t* req, int status) {
-        Write *w = reinterpret_cast<Write *>(req);
+        _Write *w = reinterpret_cast<_Write *>(req);
+        MsgPackRpc *self = reinterpret_cast<MsgPackRpc *>(req->data);
+        if (!self)
+        {
+            // The rpc has gone meanwhile
+            delete w;
+            return;
+        }
+        auto &in_flight = self->_writes_in_flight;
+        in_flight.erase(std::find(in_flight.begin(), in_flight.end(), w));
         if (status < 0)
         {
             Logger().error("Failed to write {} bytes: {}", w->buffer.size(), uv_strerror(status));
-            MsgPackRpc *self = reinterpret_cast<MsgPackRpc *>(req->data);
             self->_on_error(uv_strerror(status));
         }
-        delete w;
+        w->buffer.clear();
+        self->_free_writes.emplace_back(w);
     };
 
     uv_buf_t buf;
     buf.base = w->buffer.data();
     buf.len = w->buffer.size();
 
-    if (int err = uv_write(w.release(), _stdin_stream, &buf, 1, cb))
-        throw std::runtime_error(fmt::format("Failed to uv write: {}", uv_strerror(err)));
+    if (int err = uv_write(w.get(), _stdin_stream, &buf, 1, cb))
+    {
+        Logger().error("Failed to uv write: {}", uv_strerror(err));
+        w->buffer.clear();
+        _free_writes.push_back(std::move(w));
+        _on_error(uv_strerror(err));
+        return;
+    }
+    _writes_in_flight.push_back(w.release());
+}
+
+MsgPackRpc::CallT::CallT(MsgPackRpc &rpc, uint32_t seq)
+    : _rpc{rpc}
+    , _seq{seq}
+{
+    // The object isn't going to move: it's only returned from Call() as a prvalue.
+    _rpc._AddPending(_seq, [this](const msgpack::object &err, const msgpack::object &result) {
+        _OnResponse(err, result);
+    });
+}
+
+MsgPackRpc::CallT::~CallT()
+{
+    // Nobody is waiting for the response anymore
+    if (!_done)
+        _rpc._Cancel(_seq);
+}
+
+void MsgPackRpc::CallT::_OnResponse(const msgpack::object &err, const msgpack::object &result)
+{
+    _done = true;
+    if (_waiter)
+    {
+        // The response is valid until the next message is unpacked,
+        // the coroutine is going to use it right away.
+        _err = err;
+        _result = result;
+        _waiter.resume();
+        return;
+    }
+    // Not awaited yet, keep a copy
+    _err_copy = msgpack::clone(err);
+    _err = _err_copy.get();
+    _result_copy = msgpack::clone(result);
+    _result = _result_copy.get();
 }
 
 void MsgPackRpc::_handle_data(const char *data, size_t length)
@@ -95,9 +311,7 @@ void MsgPackRpc::_handle_data(const char *data, size_t length)
         if (arr.ptr[0] == 1)
         {
             // Response
-            auto it = _requests.find(arr.ptr[1].as<uint32_t>());
-            it->second(arr.ptr[2], arr.ptr[3]);
-            _requests.erase(it);
+            _Complete(arr.ptr[1].as<uint32_t>(), arr.ptr[2], arr.ptr[3]);
         }
         else if (arr.ptr[0] == 2)
         {
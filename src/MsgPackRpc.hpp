@@ -1,7 +1,14 @@
 #pragma once
 
+#include "Timer.hpp"
+#include "Utils.hpp"
+#include <chrono>
+#include <coroutine>
 #include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <msgpack.hpp>
 #include <uv.h>
 
@@ -26,10 +33,84 @@ public:
     using OnResponseT = std::function<void(const msgpack::object &err, const msgpack::object &resp)>;
 
     void Request(PackRequestT, OnResponseT);
-    void RequestAsync(PackRequestT pack_request, OnResponseT);
+
+    // The result of a call. The objects are valid until the next suspension
+    // of the awaiting coroutine.
+    struct Response
+    {
+        msgpack::object err;
+        msgpack::object result;
+    };
+
+    // The awaitable of a call, the coroutine is resumed in the uv loop
+    // with the response. The request is sent right away, so several calls
+    // may be in flight before awaiting them:
+    //
+    //   auto a = rpc.Call("nvim_get_var", "a");
+    //   auto b = rpc.Call("nvim_get_var", "b");
+    //   auto res_a = co_await a;
+    //   auto res_b = co_await b;
+    class CallT
+    {
+    public:
+        CallT(MsgPackRpc &, uint32_t seq);
+        CallT(const CallT &) = delete;
+        CallT& operator=(const CallT &) = delete;
+        ~CallT();
+
+        bool await_ready() const { return _done; }
+        void await_suspend(std::coroutine_handle<> waiter) { _waiter = waiter; }
+        Response await_resume() const { return {_err, _result}; }
+
+    private:
+        MsgPackRpc &_rpc;
+        uint32_t _seq;
+        bool _done = false;
+        std::coroutine_handle<> _waiter;
+        msgpack::object _err;
+        msgpack::object _result;
+        // The copies of the response that arrived before awaiting
+        msgpack::object_handle _err_copy;
+        msgpack::object_handle _result_copy;
+
+        void _OnResponse(const msgpack::object &err, const msgpack::object &result);
+    };
+
+    // Call a method packing the arguments directly, no closures involved.
+    template <typename... Args>
+    CallT Call(std::string_view method, const Args &...args)
+    {
+        uint32_t seq = _seq++;
+        PackerT pk(&_BeginRequest(seq));
+        pk.pack(method);
+        pk.pack_array(sizeof...(Args));
+        (pk.pack(args), ...);
+        _EndRequest();
+        return CallT{*this, seq};
+    }
 
     const std::string& GetOutput() const { return _output; }
 
+    // A request without a response for this long is completed with the error
+    // TIMEOUT_ERROR, and its late response is ignored. The session goes on.
+    // Neovim may legitimately take its time with a blocking command, hence the generous default.
+    static constexpr std::chrono::milliseconds DEFAULT_TIMEOUT = std::chrono::minutes{5};
+    static constexpr const char *TIMEOUT_ERROR = "Request timed out";
+    void SetTimeout(std::chrono::milliseconds);
+
+    struct Stats
+    {
+        size_t in_flight = 0;
+        size_t max_in_flight = 0;
+        uint64_t completed = 0;
+        uint64_t timed_out = 0;
+        // The time between sending a request and receiving its response
+        ClockT::duration total_latency{};
+        ClockT::duration max_latency{};
+    };
+    // The uv loop thread
+    const Stats& GetStats() const { return _stats; }
+
 private:
     uv_stream_t *_stdin_stream;
     uv_stream_t *_stdout_stream;
@@ -41,7 +122,49 @@ private:
 
     msgpack::unpacker _unp;
     uint32_t _seq = 0;
-    std::map<uint32_t, OnResponseT> _requests;
+
+    // The requests waiting for the responses in a ring indexed by seq % capacity.
+    // The sequence numbers go in order, so a slot is only occupied if the request
+    // sent capacity requests ago is still pending. The ring grows then.
+    struct _Pending
+    {
+        uint32_t seq = 0;
+        bool in_use = false;
+        OnResponseT on_response;
+        ClockT::time_point sent;
+    };
+    static constexpr size_t INITIAL_PENDING = 64;
+    std::vector<_Pending> _pending;
+    Stats _stats;
+    Timer _timeout_timer;
+    std::chrono::milliseconds _timeout = DEFAULT_TIMEOUT;
+
+    void _AddPending(uint32_t seq, OnResponseT);
+    void _GrowPending();
+    // Call the response handler and free the slot of the request seq
+    void _Complete(uint32_t seq, const msgpack::object &err, const msgpack::object &result);
+    // Free the slot of a request, return its response handler
+    OnResponseT _TakePending(_Pending &);
+    // The response isn't needed anymore, but the request is still in flight
+    void _Cancel(uint32_t seq);
+    void _StartTimeoutTimer();
+    void _CheckTimeouts();
+
+    // The requests are packed one after another into the output buffer,
+    // which is written out once per loop iteration. The buffers and
+    // the write requests are reused, so the steady state doesn't allocate.
+    msgpack::sbuffer _out;
+    struct _Write;
+    std::vector<std::unique_ptr<_Write>> _free_writes;
+    std::vector<_Write *> _writes_in_flight;
+    std::unique_ptr<uv_idle_t> _flush_idle;
+
+    // Start packing a request: the header is packed, the method and the arguments follow
+    msgpack::sbuffer& _BeginRequest(uint32_t seq);
+    // The request is packed, schedule writing
+    void _EndRequest();
+    // Write out the packed requests
+    void _Flush();
 
     void _handle_data(const char *data, size_t length);
 };
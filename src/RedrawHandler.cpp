@@ -110,7 +110,7 @@ void RedrawHandler::_OnNotification(std::string_view method, const msgpack::obje
         }
         else if (subtype == "mode_info_set")
         {
-            // Just ignore for now
+            for_each_event(event, [this](const auto &e) { _ModeInfoSet(e); });
         }
         else if (subtype == "busy_start")
         {
@@ -214,6 +214,8 @@ void RedrawHandler::_HlAttrDefine(const msgpack::object_array &event)
             attr.bg = rgb_attr.ptr[i].val.as<unsigned>();
         else if (key == "special")
             attr.special = rgb_attr.ptr[i].val.as<unsigned>();
+        else if (key == "blend")
+            attr.blend = rgb_attr.ptr[i].val.as<unsigned>();
         // nvim api docs state that boolean keys here are only sent if true
         else if (key == "reverse")
             attr.flags |= HlAttr::F_REVERSE;
@@ -250,8 +252,51 @@ void RedrawHandler::_GridResize(const msgpack::object_array &event)
     _renderer->GridResize(width, height);
 }
 
+void RedrawHandler::_ModeInfoSet(const msgpack::object_array &event)
+{
+    bool cursor_style_enabled = event.ptr[0].as<bool>();
+    const auto &mode_info = event.ptr[1].via.array;
+
+    std::vector<CursorStyle> styles(mode_info.size);
+    for (size_t i = 0; i < mode_info.size; ++i)
+    {
+        auto &style = styles[i];
+        const auto &info = mode_info.ptr[i].via.map;
+        for (size_t j = 0; j < info.size; ++j)
+        {
+            std::string_view key{info.ptr[j].key.as<std::string_view>()};
+            const auto &val = info.ptr[j].val;
+            if (key == "cursor_shape")
+            {
+                std::string_view shape{val.as<std::string_view>()};
+                if (shape == "vertical")
+                    style.shape = CursorStyle::VERTICAL;
+                else if (shape == "horizontal")
+                    style.shape = CursorStyle::HORIZONTAL;
+                else
+                    style.shape = CursorStyle::BLOCK;
+            }
+            else if (key == "cell_percentage")
+                style.cell_percentage = val.as<int>();
+            else if (key == "blinkwait")
+                style.blinkwait = val.as<int>();
+            else if (key == "blinkon")
+                style.blinkon = val.as<int>();
+            else if (key == "blinkoff")
+                style.blinkoff = val.as<int>();
+            else if (key == "attr_id")
+                style.attr_id = val.as<unsigned>();
+            else if (key == "name")
+                style.name = val.as<std::string_view>();
+            // attr_id_lm, short_name, mouse_shape aren't used
+        }
+    }
+    _renderer->ModeInfoSet(cursor_style_enabled, std::move(styles));
+}
+
 void RedrawHandler::_ModeChange(const msgpack::object_array &event)
 {
     auto mode = event.ptr[0].as<std::string_view>();
-    _renderer->ModeChange(mode);
+    int mode_idx = event.ptr[1].as<int>();
+    _renderer->ModeChange(mode, mode_idx);
 }
@@ -27,5 +27,6 @@ private:
     void _GridClear(const msgpack::object_array &event);
     void _HlAttrDefine(const msgpack::object_array &event);
     void _GridResize(const msgpack::object_array &event);
+    void _ModeInfoSet(const msgpack::object_array &event);
     void _ModeChange(const msgpack::object_array &event);
 };
@@ -2,18 +2,19 @@
 #include "MsgPackRpc.hpp"
 #include "IWindow.hpp"
 #include "Logger.hpp"
+#include "SlabPool.hpp"
 #include <sstream>
+#include <algorithm>
+#include <memory_resource>
 
 
-Renderer::Renderer(uv_loop_t *loop, MsgPackRpc *rpc)
+Renderer::Renderer(AsyncExec &exec, MsgPackRpc *rpc)
     : _rpc{rpc}
-    , _timer{loop}
-    , _async_exec{loop}
+    , _timer{exec.GetLoop()}
+    , _exec{exec}
+    , _worker_pool{std::clamp(std::thread::hardware_concurrency(), 1u, 4u) - 1}
+    , _splitters(_worker_pool.GetWorkerCount())
 {
-    // Default hightlight attributes
-    _def_attr.fg = 0xffffff;
-    _def_attr.bg = 0;
-
     // Prepare the initial cell grid to fill the whole window.
     // The NeoVim UI will be attached using these dimensions.
     GridResize(80, 25);
@@ -37,12 +38,10 @@ void Renderer::Flush()
     // It's worth limiting flush rate, a user wouldn't necessarily need
     // to observe the intermediate screen states. And the CPU consumption
     // is improved dramatically when limiting the flush rate.
-
-    // 40 ms => 25 FPS (PAL). Perhaps worth making it configurable.
-    const int FLUSH_DURATION_MS = 40;
-
-    auto now = ClockT::now();
-    if (now - _last_flush_time > std::chrono::milliseconds(FLUSH_DURATION_MS))
+    // The policy lets the response to the input through immediately,
+    // and throttles sustained updates according to the frame cost.
+    auto delay = _flush_policy.GetDelay(ClockT::now(), _last_flush_time);
+    if (delay == delay.zero())
     {
         // Do repaint the grid if enough time elapsed since last time.
         // This is useful when fast scrolling.
@@ -51,7 +50,8 @@ void Renderer::Flush()
     else
     {
         // Make sure the final view will be presented if no more flush requests.
-        _timer.Start(FLUSH_DURATION_MS, 0, [&] {
+        auto delay_ms = std::chrono::ceil<std::chrono::milliseconds>(delay).count();
+        _timer.Start(delay_ms, 0, [&] {
             auto lock = Lock();
             _DoFlush();
         });
@@ -64,6 +64,52 @@ void Renderer::_AnticipateFlush()
     _timer.Stop();
 }
 
+namespace {
+
+// Keep the chunks of the previous row away from the changed columns.
+// A chunk boundary depends on the cells up to two columns around it,
+// so only the cells between the kept chunks need splitting again.
+// The kept chunks are the same objects, their labels stay intact.
+template <typename LineT, typename SplitT>
+void UpdateChunks(GridLine::Row::ChunksT &chunks, const GridLine::Row::ChunksT *prev_chunks,
+                  const LineT &line, SplitT split)
+{
+    size_t prefix{}, suffix{};
+    if (prev_chunks)
+    {
+        while (prefix < prev_chunks->size() && (*prev_chunks)[prefix]->GetEnd() + 2 <= line.dirty_begin)
+            ++prefix;
+        suffix = prev_chunks->size();
+        while (suffix > prefix && (*prev_chunks)[suffix - 1]->col - 2 >= line.dirty_end)
+            --suffix;
+    }
+    size_t begin = prefix ? (*prev_chunks)[prefix - 1]->GetEnd() : 0;
+    size_t end = prev_chunks && suffix < prev_chunks->size() ? (*prev_chunks)[suffix]->col : line.hl_id.size();
+
+    if (prev_chunks)
+        chunks.reserve(prev_chunks->size() + 4);
+    if (prefix)
+        chunks.assign(prev_chunks->begin(), prev_chunks->begin() + prefix);
+    if (begin < end)
+    {
+        size_t first = chunks.size();
+        split(begin, end);
+        // The redrawn cells may still look the same, like the text under a moved
+        // cursorline. Take the previous chunks then to keep their labels.
+        for (size_t i = first, j = prefix; i < chunks.size() && prev_chunks; ++i)
+        {
+            while (j < suffix && (*prev_chunks)[j]->col < chunks[i]->col)
+                ++j;
+            if (j < suffix && *(*prev_chunks)[j] == *chunks[i])
+                chunks[i] = (*prev_chunks)[j];
+        }
+    }
+    if (prev_chunks)
+        chunks.insert(chunks.end(), prev_chunks->begin() + suffix, prev_chunks->end());
+}
+
+} //namespace;
+
 void Renderer::_DoFlush()
 {
     // Something has changed in the screen, wait for the next occasion.
@@ -71,10 +117,31 @@ void Renderer::_DoFlush()
         return;
 
     _AnticipateFlush();
-    std::ostringstream oss;
-    oss << "";
     _last_flush_time = ClockT::now();
 
+    if (_def_colors_changed)
+    {
+        _def_colors_changed = false;
+        // The presented chunks refer to the text classes by number, so the table
+        // is only compacted here, under the lock, right before rebuilding all the rows.
+        if (_hl_table.Compact())
+        {
+            for (auto &line : _lines)
+            {
+                line.Invalidate();
+                line.restyle = true;
+            }
+        }
+        _def_attr_modified = true;
+    }
+
+    // The temporary vectors of the frame are taken from the arena.
+    // The buffer only grows with the grid, so the steady state doesn't allocate.
+    size_t arena_size = 2 * (_grid_lines.size() + 2) * sizeof(RowT) + _grid_lines.size() * sizeof(int);
+    if (_frame_buffer.size() < arena_size)
+        _frame_buffer.resize(arena_size);
+    std::pmr::monotonic_buffer_resource arena{_frame_buffer.data(), _frame_buffer.size()};
+
     // Consider the _lines, which contain individual cells (text,hl_id).
     // Compute _grid_lines from this reusing the chunks as much as possible.
 
@@ -82,20 +149,22 @@ void Renderer::_DoFlush()
     // They may be reused if scrolling is detected.
     // Note that we leave alone prev_lines.front() and prev_lines.back()
     // to avoid checking for boundaries later.
-    std::vector<ChunkT> prev_lines(_grid_lines.size() + 2);
+    std::pmr::vector<RowT> prev_lines(_grid_lines.size() + 2, &arena);
     for (int row = 0, rowN = _grid_lines.size(); row < rowN; ++row)
     {
         // Skip through the surviving lines
         if (!_lines[row].dirty)
             continue;
-        auto chunk = _grid_lines[row];
+        // The restyled lines are going to be recreated, don't let them be reused.
+        if (_lines[row].restyle)
+            continue;
         prev_lines[row + 1].swap(_grid_lines[row]);
     }
 
     // Analyze the grid cells (text,hl_id) and create the actual lines for the changed rows.
-    std::vector<ChunkT> next_lines(_grid_lines.size());
-    int next_lines_count{};
-
+    // The bookkeeping goes first, then the rows are built independently of each other.
+    std::pmr::vector<int> dirty_rows(&arena);
+    dirty_rows.reserve(_lines.size());
     for (int row = 0, rowN = _lines.size(); row < rowN; ++row)
     {
         auto &line = _lines[row];
@@ -107,52 +176,34 @@ void Renderer::_DoFlush()
         // Mark the line clear as we're going to redraw the necessary parts
         // and update the texture cache.
         line.dirty = false;
+        line.restyle = false;
+        _grid_modified = true;
 
-        // Split the cells into chunks by the same hl_id
-        auto chunks = _SplitChunks(line);
-
-        auto isInvisibleSpace = [&](const GridLine::Word &word) -> bool {
-            if (!word.IsSpace())
-                return false;
-            const auto hlit = _hl_attr_map.find(word.hl_id);
-            unsigned def_bg = _def_attr.bg.value();
-
-            if (hlit == _hl_attr_map.end()                               // No highlighting
-                || (hlit->second.bg.value_or(def_bg) == def_bg           // Default background
-                    && 0 == (hlit->second.flags & HlAttr::F_REVERSE)))   // No reverse (foreground becomes background)
-            {
-                return true;
-            }
-            return false;
-        };
-
-        // Create grid line chunks
-        ChunkT line_chunk(new GridLine::Chunk{0, {}});
+        _UpdateHlRows(row, line);
+        dirty_rows.push_back(row);
+    }
 
-        // Group the words into one big word
-        for (size_t i = 1; i < chunks.size(); ++i)
-        {
-            int begin = chunks[i - 1];
-            int end = chunks[i];
-            unsigned hl_id = line.hl_id[begin];
-            GridLine::Word word{hl_id, ""};
-            for (int i{begin}; i < end; ++i)
-                word.text += line.text[i];
-            // Instant optimization: ignore the tailing invisible space
-            if (i == chunks.size() - 1 && isInvisibleSpace(word))
-                break;
-            line_chunk->width = end;
-            line_chunk->words.push_back(std::move(word));
-        }
+    std::pmr::vector<RowT> next_lines(_grid_lines.size(), &arena);
+    auto buildRow = [&](size_t i, unsigned worker) {
+        int row = dirty_rows[i];
+        next_lines[row] = _BuildRow(_lines[row], prev_lines[row + 1].get(), _splitters[worker]);
+    };
+    // Spreading the work only pays off for the big redraws.
+    if (static_cast<int>(dirty_rows.size()) >= PARALLEL_MIN_ROWS)
+        _worker_pool.ParallelFor(dirty_rows.size(), buildRow);
+    else
+    {
+        for (size_t i = 0; i < dirty_rows.size(); ++i)
+            buildRow(i, 0);
+    }
 
-        if (!line_chunk->width)
-        {
+    int next_lines_count{};
+    for (int row : dirty_rows)
+    {
+        if (next_lines[row])
+            ++next_lines_count;
+        else
             _grid_lines[row].reset();
-            continue;
-        }
-
-        next_lines[row] = std::move(line_chunk);
-        ++next_lines_count;
     }
 
     // Detect the scroll direction. There likely be one direction in the whole screen
@@ -161,14 +212,14 @@ void Renderer::_DoFlush()
     int scroll_up{}, scroll_down{};
     for (int row = 0, rowN = _lines.size(); row < rowN; ++row)
     {
-        auto &line_chunk = next_lines[row];
+        auto &line_row = next_lines[row];
 
         // Check if it's possible to just copy the prepared textures first
         if (!next_lines[row])
             continue;
-        if (prev_lines[row] && *prev_lines[row] == *line_chunk)
+        if (prev_lines[row] && *prev_lines[row] == *line_row)
             ++scroll_up;
-        if (prev_lines[row + 2] && *prev_lines[row + 2] == *line_chunk)
+        if (prev_lines[row + 2] && *prev_lines[row + 2] == *line_row)
             ++scroll_down;
     }
     int scroll_dir{};
@@ -182,7 +233,7 @@ void Renderer::_DoFlush()
     // prev_lines if it's scrolling or from new_lines otherwise.
     for (int row = 0, rowN = _lines.size(); row < rowN; ++row)
     {
-        auto &line_chunk = next_lines[row];
+        auto &line_row = next_lines[row];
 
         // Check if it's possible to just copy the prepared textures first
         if (!next_lines[row])
@@ -190,75 +241,203 @@ void Renderer::_DoFlush()
 
         if (!scroll_dir)
         {
-            _grid_lines[row] = line_chunk;
+            _grid_lines[row] = line_row;
             continue;
         }
 
         // Try reusing one of the previous chunks if possible.
         // This will result in just movement of the previous label instead of rerendering.
         // This will enable implementing smooth scrolling.
-        auto prev_chunk = std::move(prev_lines[row + scroll_dir + 1]);
-        _grid_lines[row] = prev_chunk && *prev_chunk == *line_chunk
-            ? std::move(prev_chunk)
-            : line_chunk;
+        auto prev_row = std::move(prev_lines[row + scroll_dir + 1]);
+        _grid_lines[row] = prev_row && *prev_row == *line_row
+            ? std::move(prev_row)
+            : line_row;
     }
 
     // If necessary, a bit more effort could be put to reuse lines evey further,
     // but those rows will need to be marked for instance label movement as they
     // aren't part of scrolling.
 
+    _MergeScroll(_flushed_scroll, _pending_scroll);
+    _pending_scroll = {};
+
+    // The cursor is painted with the resolved background of its highlighting,
+    // or with the default foreground if the highlighting doesn't set any.
+    // It's opaque unless the highlighting sets blend.
+    unsigned cursor_color = GetFg();
+    unsigned cursor_blend = 0;
+    if (_mode_idx < static_cast<int>(_cursor_styles.size()))
+    {
+        if (unsigned attr_id = _cursor_styles[_mode_idx].attr_id)
+        {
+            const auto &entry = _hl_table[_hl_table.GetClass(attr_id)];
+            if (entry.attr.bg.has_value() || (entry.attr.flags & HlAttr::F_REVERSE))
+                cursor_color = entry.bg;
+            cursor_blend = std::min(entry.attr.blend, 100u);
+        }
+    }
+    _cursor_state.store(CursorState{
+            .row = static_cast<uint64_t>(_cursor_row),
+            .col = static_cast<uint64_t>(_cursor_col),
+            .color = cursor_color,
+            .blend = cursor_blend,
+            .mode_idx = static_cast<uint64_t>(std::min(_mode_idx, CursorState::MAX_MODE_IDX)),
+            .busy = _is_busy,
+        }, std::memory_order_release);
+
+    // Only the cursor has moved, the grid doesn't need to be presented again.
+    bool grid_modified = _grid_modified || _def_attr_modified || _cursor_styles_modified;
+    _grid_modified = false;
     if (_window)
-        _window->Present();
+    {
+        if (grid_modified)
+            _window->Present();
+        else
+            _window->PresentCursor();
+    }
 
     auto end_time = ClockT::now();
-    oss << " " << ToMs(end_time - _last_flush_time).count();
-    Logger().debug("Flush {} ms", oss.str());
+    _flush_policy.ReportFlushCost(end_time - _last_flush_time);
+    Logger().debug("Flush {} ms", ToMs(end_time - _last_flush_time).count());
+}
+
+void Renderer::_UpdateHlRows(int row, _Line &line)
+{
+    // Forget the highlighting the line had before
+    for (unsigned hl_id : line.hl_used)
+        _hl_rows[hl_id][row] = false;
+    line.hl_used.clear();
+
+    // The chunks may merge different hl_ids of the same class, so check every run of cells.
+    for (size_t col = 0; col < line.hl_id.size(); ++col)
+    {
+        unsigned hl_id = line.hl_id[col];
+        if (col > 0 && hl_id == line.hl_id[col - 1])
+            continue;
+        if (std::find(line.hl_used.begin(), line.hl_used.end(), hl_id) != line.hl_used.end())
+            continue;
+        line.hl_used.push_back(hl_id);
+        if (hl_id >= _hl_rows.size())
+            _hl_rows.resize(hl_id + 1);
+        auto &rows = _hl_rows[hl_id];
+        if (rows.size() < _lines.size())
+            rows.resize(_lines.size());
+        rows[row] = true;
+    }
 }
 
-std::vector<size_t> Renderer::_SplitChunks(const _Line &line)
+void Renderer::_InvalidateHlRows(unsigned hl_id)
 {
-    // Split the line into the chunks with contiguous highlighting.
-    // However, contiguous spaces should form their own chunk to avoid unnecessary text rerendering.
-    const auto &hl = line.hl_id;
-    const auto &text = line.text;
-
-    std::vector<size_t> chunks;
-    chunks.push_back(0);
-    chunks.push_back(1);
-    bool is_space = false;
-    while (chunks.back() < hl.size())
+    if (hl_id >= _hl_rows.size())
+        return;
+    const auto &rows = _hl_rows[hl_id];
+    for (size_t row = 0, rowN = std::min(rows.size(), _lines.size()); row < rowN; ++row)
     {
-        size_t back = chunks.back();
-        if (hl[back] != hl[chunks[chunks.size() - 2]])
+        if (rows[row])
         {
-            chunks.push_back(back + 1);
-            is_space = false;
+            _lines[row].Invalidate();
+            _lines[row].restyle = true;
         }
-        else if (!is_space && back > 0
-                 && text[back] == " " && text[back - 1] == " ")
+    }
+}
+
+const std::vector<size_t>& Renderer::_SplitChunks(const _Line &line, const std::vector<unsigned> &hl_class,
+                                                  ChunkSplitter &splitter, size_t begin, size_t end)
+{
+    uint32_t *cells = splitter.GetCells(end - begin);
+    for (size_t i = begin; i < end; ++i)
+    {
+        unsigned hl_id = line.hl_id[i];
+        cells[i - begin] = ChunkSplitter::Pack(hl_id < hl_class.size() ? hl_class[hl_id] : 0, line.text[i] == " ");
+    }
+    return splitter.Split();
+}
+
+Renderer::RowT Renderer::_BuildRow(const _Line &line, const GridLine::Row *prev_row, ChunkSplitter &splitter) const
+{
+    // The row and its chunks, and their control blocks, come from the slab pool.
+    auto line_row = std::allocate_shared<GridLine::Row>(SlabAllocator<GridLine::Row>{});
+
+    // Only the columns around the changes are split again, the text and the backgrounds alike.
+    UpdateChunks(line_row->chunks, prev_row ? &prev_row->chunks : nullptr, line, [&](size_t begin, size_t end) {
+        _SplitRow(line, begin, end, line_row->chunks, splitter);
+    });
+    UpdateChunks(line_row->backgrounds, prev_row ? &prev_row->backgrounds : nullptr, line, [&](size_t begin, size_t end) {
+        _SplitBackground(line, begin, end, line_row->backgrounds);
+    });
+
+    if (line_row->chunks.empty() && line_row->backgrounds.empty())
+        return {};
+    return line_row;
+}
+
+void Renderer::_SplitRow(const _Line &line, size_t begin, size_t end, GridLine::Row::ChunksT &row_chunks,
+                         ChunkSplitter &splitter) const
+{
+    const auto &words = _SplitChunks(line, _hl_table.GetTextClasses(), splitter, begin, end);
+
+    // Collect the words into the chunks between the runs of spaces.
+    // The runs with decorations go to their own chunks, the plain ones are skipped:
+    // there's nothing to draw but the background.
+    GridLine::Chunk::PtrT chunk;
+    auto finishChunk = [&] {
+        if (chunk)
+            row_chunks.push_back(std::move(chunk));
+        chunk.reset();
+    };
+
+    for (size_t i = 1; i < words.size(); ++i)
+    {
+        int word_begin = begin + words[i - 1];
+        int word_end = begin + words[i];
+        GridLine::Word word{_hl_table.GetTextClass(line.hl_id[word_begin]), "", word_begin};
+        size_t text_size{};
+        for (int i{word_begin}; i < word_end; ++i)
+            text_size += line.text[i].size();
+        word.text.reserve(text_size);
+        for (int i{word_begin}; i < word_end; ++i)
+            word.text += line.text[i];
+
+        bool is_space = word.IsSpace();
+        if (is_space)
         {
-            // Make sure contiguous spaces form their own chunk
-            is_space = true;
-            // If the line started with spaces, no need to form a new chunk. Otherwise:
-            if (back > 1)
-            {
-                chunks.back() = back - 1;
-                // Remove empty chunks immediately
-                if (chunks[chunks.size() - 2] == chunks.back())
-                    chunks.resize(chunks.size() - 1);
-                chunks.push_back(back + 1);
-            }
+            finishChunk();
+            if (!_hl_table.GetText(word.text_class).has_decoration)
+                continue;
         }
-        else if (is_space && text[back] != " ")
+        if (!chunk)
         {
-            // End of space chunk
-            is_space = false;
-            chunks.push_back(back + 1);
+            chunk = std::allocate_shared<GridLine::Chunk>(SlabAllocator<GridLine::Chunk>{}, 0, GridLine::Chunk::WordsT{});
+            chunk->col = word_begin;
         }
-        else
-            ++chunks.back();
+        chunk->width = word_end - chunk->col;
+        chunk->words.push_back(std::move(word));
+        if (is_space)
+            finishChunk();
+    }
+    finishChunk();
+}
+
+void Renderer::_SplitBackground(const _Line &line, size_t begin, size_t end, GridLine::Row::ChunksT &backgrounds) const
+{
+    // The default background is the grid itself, only the other colors are filled
+    uint32_t def_bg = _hl_table.GetDefBg();
+    auto bgOf = [&](size_t col) { return _hl_table[_hl_table.GetClass(line.hl_id[col])].bg; };
+    for (size_t col = begin; col < end; )
+    {
+        uint32_t bg = bgOf(col);
+        size_t run_end = col + 1;
+        while (run_end < end && bgOf(run_end) == bg)
+            ++run_end;
+        if (bg != def_bg)
+        {
+            auto chunk = std::allocate_shared<GridLine::Chunk>(SlabAllocator<GridLine::Chunk>{}, run_end - col, GridLine::Chunk::WordsT{});
+            chunk->col = col;
+            chunk->bg = bg;
+            backgrounds.push_back(std::move(chunk));
+        }
+        col = run_end;
     }
-    return chunks;
 }
 
 void Renderer::GridLine(int row, int col, std::string_view chunk, unsigned hl_id, int repeat)
@@ -268,7 +447,7 @@ void Renderer::GridLine(int row, int col, std::string_view chunk, unsigned hl_id
     _is_clean = false;
 
     _Line &line = _lines[row];
-    line.dirty = true;
+    line.Invalidate(col, col + repeat);
 
     for (int i = 0; i < repeat; ++i)
     {
@@ -290,10 +469,15 @@ void Renderer::GridScroll(int top, int bot, int left, int right, int rows)
     Logger().debug("Scroll top={} bot={} left={} right={} rows={}", top, bot, left, right, rows);
     _AnticipateFlush();
     _is_clean = false;
+    // Partial width scrolling changes the whole lines, nothing to animate there.
+    if (left == 0 && right == GetWidth())
+        _MergeScroll(_pending_scroll, {top, bot, rows});
+    else
+        _pending_scroll = {};
     auto copy = [&](int row, int row_from) {
         auto &line_from = _lines[row_from];
         auto &line_to = _lines[row];
-        line_to.dirty = true;
+        line_to.Invalidate(left, right);
         for (int col = left; col < right; ++col)
         {
             line_to.text[col] = std::move(line_from.text[col]);
@@ -317,6 +501,17 @@ void Renderer::GridScroll(int top, int bot, int left, int right, int rows)
     }
 }
 
+void Renderer::_MergeScroll(ScrollRegion &to, const ScrollRegion &scroll)
+{
+    // Consecutive scrolling of the same region adds up, otherwise only the latest one counts.
+    if (!scroll.rows)
+        return;
+    if (to.rows && to.top == scroll.top && to.bot == scroll.bot)
+        to.rows += scroll.rows;
+    else
+        to = scroll;
+}
+
 void Renderer::GridClear()
 {
     Logger().debug("Clear");
@@ -324,7 +519,7 @@ void Renderer::GridClear()
     _is_clean = false;
     for (auto &line : _lines)
     {
-        line.dirty = true;
+        line.Invalidate();
         for (auto &t : line.text)
             t = ' ';
         for (auto &hl : line.hl_id)
@@ -335,20 +530,30 @@ void Renderer::GridClear()
 void Renderer::HlAttrDefine(unsigned hl_id, HlAttr attr)
 {
     Logger().debug("HlAttrDefine {}", hl_id);
-    _hl_attr_map[hl_id] = attr;
-    _hl_attr_modified = true;
+
+    // Neovim may send the same definition again, nothing to update then
+    if (!_hl_table.Define(hl_id, attr))
+        return;
+    // Redraw the lines using the highlighting
+    _InvalidateHlRows(hl_id);
 }
 
 void Renderer::DefaultColorSet(unsigned fg, unsigned bg)
 {
     Logger().debug("DefaultColorSet fg={} bg={}", fg, bg);
+    if (!_hl_table.SetDefault(fg, bg))
+        return;
 
-    for (auto &line : _lines)
-        line.dirty = true;
-
-    _def_attr.fg = fg;
-    _def_attr.bg = bg;
-    _hl_attr_modified = true;
+    // The default colors are applied by the style of the grid. Only the highlighting
+    // that depends on them explicitly needs redrawing: the reverse foreground
+    // and background, and the detection of invisible spaces.
+    for (unsigned hl_id = 0; hl_id < _hl_table.GetIdCount(); ++hl_id)
+    {
+        if (_hl_table[_hl_table.GetClass(hl_id)].DependsOnDefault())
+            _InvalidateHlRows(hl_id);
+    }
+    // The window learns about the change with the rows rebuilt for it
+    _def_colors_changed = true;
 }
 
 void Renderer::OnResized(int rows, int cols)
@@ -356,24 +561,19 @@ void Renderer::OnResized(int rows, int cols)
     if (rows != static_cast<int>(_lines.size()) ||
         cols != static_cast<int>(_lines[0].text.size()))
     {
-        _async_exec.Post([rows, cols, this] {
-            _rpc->Request(
-                [rows, cols](auto &pk) {
-                    pk.pack("nvim_ui_try_resize");
-                    pk.pack_array(2);
-                    pk.pack(cols);
-                    pk.pack(rows);
-                },
-                [](const msgpack::object &err, const auto &/*resp*/) {
-                    if (!err.is_nil())
-                    {
-                        std::ostringstream oss;
-                        oss << "Failed to resize UI " << err << std::endl;
-                        throw std::runtime_error(oss.str());
-                    }
-                }
-            );
-        });
+        _exec.Post(Executor::RESIZE, [rows, cols, this] { _TryResize(rows, cols); });
+    }
+}
+
+Coroutine Renderer::_TryResize(int rows, int cols)
+{
+    auto res = co_await _rpc->Call("nvim_ui_try_resize", cols, rows);
+    if (!res.err.is_nil())
+    {
+        // The grid keeps its size, the next resize will try again
+        std::ostringstream oss;
+        oss << res.err;
+        Logger().error("Failed to resize UI: {}", oss.str());
     }
 }
 
@@ -385,20 +585,41 @@ void Renderer::GridResize(int width, int height)
     {
         line.hl_id.resize(width, 0);
         line.text.resize(width, " ");
+        // The previous chunks may span past the new width
+        line.Invalidate();
     }
 
     _grid_lines.resize(height);
+    _grid_modified = true;
+    // Whichever worker gets a row, it doesn't need to allocate to split it
+    for (auto &splitter : _splitters)
+        splitter.Reserve(width);
+    // The scrolling can't be animated across resizing
+    _pending_scroll = _flushed_scroll = {};
+}
+
+void Renderer::ModeInfoSet(bool cursor_style_enabled, std::vector<CursorStyle> styles)
+{
+    Logger().debug("ModeInfoSet cursor_style_enabled={} modes={}", cursor_style_enabled, styles.size());
+    // Without the cursor styling, the block cursor is used everywhere
+    if (!cursor_style_enabled)
+        styles.clear();
+    _cursor_styles = std::move(styles);
+    _cursor_styles_modified = true;
 }
 
-void Renderer::ModeChange(std::string_view mode)
+void Renderer::ModeChange(std::string_view mode, int mode_idx)
 {
-    Logger().debug("ModeChange {}", mode);
+    Logger().debug("ModeChange {} {}", mode, mode_idx);
     _mode = mode;
+    _mode_idx = mode_idx;
 }
 
 void Renderer::SetBusy(bool is_busy)
 {
     Logger().debug("SetBusy {}", is_busy);
+    // The mouse pointer reflects the busy state too
+    _grid_modified |= _is_busy != is_busy;
     _is_busy = is_busy;
 }
 
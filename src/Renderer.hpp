@@ -1,15 +1,25 @@
 #pragma once
 
-#include "HlAttr.hpp"
+#include "ChunkSplitter.hpp"
+#include "HlTable.hpp"
+#include "CursorStyle.hpp"
 #include "GridLine.hpp"
 #include "AsyncExec.hpp"
+#include "Coroutine.hpp"
 #include "Timer.hpp"
+#include "FlushPolicy.hpp"
 #include "Utils.hpp"
+#include "WorkerPool.hpp"
 
 #include <vector>
 #include <string_view>
 #include <string>
 #include <mutex>
+#include <utility>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <algorithm>
 
 class MsgPackRpc;
 struct IWindow;
@@ -17,7 +27,7 @@ struct IWindow;
 class Renderer
 {
 public:
-    Renderer(uv_loop_t *, MsgPackRpc *);
+    Renderer(AsyncExec &, MsgPackRpc *);
     ~Renderer();
 
     void SetWindow(IWindow *);
@@ -27,6 +37,8 @@ public:
     int GetWidth() const { return _lines[0].hl_id.size(); }
 
     void Flush();
+    // Decides how often the flushes are done, the costs of presenting are reported there.
+    FlushPolicy& GetFlushPolicy() { return _flush_policy; }
 
     // Window was resized
     void OnResized(int rows, int cols);
@@ -38,13 +50,23 @@ public:
     void GridClear();
     void HlAttrDefine(unsigned hl_id, HlAttr attr);
     void DefaultColorSet(unsigned fg, unsigned bg);
-    void ModeChange(std::string_view mode);
+    void ModeInfoSet(bool cursor_style_enabled, std::vector<CursorStyle> styles);
+    void ModeChange(std::string_view mode, int mode_idx);
     void SetBusy(bool is_busy);
     void SetGuiFont(std::string_view);
 
+    // The region scrolled since the last time it was taken, useful for animation.
+    // Only the full width scrolling is considered, rows is 0 if there was none.
+    struct ScrollRegion
+    {
+        int top{}, bot{}, rows{};
+    };
+    ScrollRegion TakeScroll() { return std::exchange(_flushed_scroll, {}); }
+
     // The snapshot of last consistent grid state
     using ChunkT = GridLine::Chunk::PtrT;
-    using GridLinesT = std::vector<ChunkT>;
+    using RowT = GridLine::Row::PtrT;
+    using GridLinesT = std::vector<RowT>;
     const GridLinesT& GetGridLines() const { return _grid_lines; }
 
     std::lock_guard<std::mutex> Lock()
@@ -52,31 +74,71 @@ public:
         return std::lock_guard<std::mutex>{_mutex};
     }
 
-    const HlAttr::MapT& GetAttrMap() const { return _hl_attr_map; }
-    bool IsAttrMapModified() const { return _hl_attr_modified; }
-    void MarkAttrMapProcessed() { _hl_attr_modified = false; }
-    unsigned GetBg() const { return _def_attr.bg.value(); }
-    unsigned GetFg() const { return _def_attr.fg.value(); }
-    const HlAttr& GetDefAttr() const { return _def_attr; }
+    // Visually identical highlight ids are merged into the same class.
+    // The classes are only appended, the existing ones never change
+    // unless the default colors change. The unused ones are dropped
+    // by the flush after that, see IsDefAttrModified().
+    const HlTable& GetHlTable() const { return _hl_table; }
+    // Were the default colors changed since the last time the changes were processed?
+    bool IsDefAttrModified() const { return _def_attr_modified; }
+    void MarkAttrMapProcessed() { _def_attr_modified = false; }
+    unsigned GetBg() const { return _hl_table.GetDefBg(); }
+    unsigned GetFg() const { return _hl_table.GetDefFg(); }
+    const HlAttr& GetDefAttr() const { return _hl_table.GetDefAttr(); }
 
     bool IsBusy() const { return _is_busy; }
     int GetCursorRow() const { return _cursor_row; }
     int GetCursorCol() const { return _cursor_col; }
     const std::string& GetMode() const { return _mode; }
 
+    // The cursor styles indexed by mode_idx, parsed from mode_info_set
+    const std::vector<CursorStyle>& GetCursorStyles() const { return _cursor_styles; }
+    // Were the cursor styles changed since the last time they were processed?
+    bool IsCursorStylesModified() const { return _cursor_styles_modified; }
+    void MarkCursorStylesProcessed() { _cursor_styles_modified = false; }
+
+    // The cursor as of the last flush packed into a word,
+    // so that it can be read without locking the renderer.
+    struct CursorState
+    {
+        static constexpr int MAX_MODE_IDX = 127;
+
+        uint64_t row : 12 = 0;
+        uint64_t col : 13 = 0;
+        uint64_t color : 24 = 0;
+        // The transparency of the cursor highlighting in percent
+        uint64_t blend : 7 = 0;
+        // The index into the cursor styles
+        uint64_t mode_idx : 7 = 0;
+        uint64_t busy : 1 = false;
+
+        bool operator==(const CursorState &) const = default;
+    };
+    CursorState GetCursorState() const { return _cursor_state.load(std::memory_order_acquire); }
+
 private:
     MsgPackRpc *_rpc;
     Timer _timer;
-    AsyncExec _async_exec;
+    AsyncExec &_exec;
     IWindow *_window = nullptr;
 
-    HlAttr::MapT _hl_attr_map;
-    bool _hl_attr_modified = false;
-    HlAttr _def_attr;
+    // Ask neovim to resize the grid, the uv loop
+    Coroutine _TryResize(int rows, int cols);
+
+    HlTable _hl_table;
+    // The default colors have changed since the last flush
+    bool _def_colors_changed = false;
+    bool _def_attr_modified = false;
     int _cursor_row = 0;
     int _cursor_col = 0;
     std::string _mode;
+    int _mode_idx = 0;
+    std::vector<CursorStyle> _cursor_styles;
+    bool _cursor_styles_modified = false;
     bool _is_busy = false;
+    std::atomic<CursorState> _cursor_state{};
+    // Anything but the cursor needs presenting since the last flush
+    bool _grid_modified = true;
 
     struct _Line
     {
@@ -84,6 +146,22 @@ private:
         std::vector<unsigned> hl_id;
         // Is it necessary to redraw this line carefully or can just draw from the texture cache?
         bool dirty = true;
+        // The columns changed since the last flush [dirty_begin, dirty_end)
+        int dirty_begin = 0;
+        int dirty_end = std::numeric_limits<int>::max();
+        // The line has to be recreated because its highlighting was redefined,
+        // the previous chunk can't be reused even if the text is the same.
+        bool restyle = false;
+        // The highlight ids used in the line as of the last flush
+        std::vector<unsigned> hl_used{};
+
+        // Mark the columns changed, the whole line by default
+        void Invalidate(int begin = 0, int end = std::numeric_limits<int>::max())
+        {
+            dirty_begin = dirty ? std::min(dirty_begin, begin) : begin;
+            dirty_end = dirty ? std::max(dirty_end, end) : end;
+            dirty = true;
+        }
     };
 
     // The volatile state of the grid, the changes are collected here first
@@ -93,10 +171,41 @@ private:
     GridLinesT _grid_lines;
     std::mutex _mutex;
 
-    static std::vector<size_t> _SplitChunks(const _Line &);
+    // Split comparing the highlighting classes of the ids.
+    // Reuse the buffers of the splitter, the result is valid until its next use
+    // Only the columns [begin, end) are split, the offsets are relative to begin.
+    static const std::vector<size_t>& _SplitChunks(const _Line &, const std::vector<unsigned> &hl_class,
+                                                   ChunkSplitter &, size_t begin, size_t end);
+    // Build the row of a changed line reusing the chunks of the previous row if any.
+    // The rows are independent, so they may be built by several workers at once:
+    // every worker has its own splitter, the rest of the state is only read.
+    RowT _BuildRow(const _Line &, const GridLine::Row *prev_row, ChunkSplitter &) const;
+    // Split the columns [begin, end) of the line into the chunks of a row
+    void _SplitRow(const _Line &, size_t begin, size_t end, GridLine::Row::ChunksT &, ChunkSplitter &) const;
+    // Find the runs of the non-default background in the columns [begin, end)
+    void _SplitBackground(const _Line &, size_t begin, size_t end, GridLine::Row::ChunksT &) const;
+
+    // The big redraws are built in parallel, the small updates stay on the calling thread.
+    static constexpr int PARALLEL_MIN_ROWS = 16;
+    WorkerPool _worker_pool;
+    std::vector<ChunkSplitter> _splitters;
+
+    // The memory for the temporary vectors of a flush
+    std::vector<std::byte> _frame_buffer;
+
+    // Which rows use a given highlight id: a bitset of rows for every hl_id.
+    // When a highlight is redefined, only these rows need to be redrawn.
+    std::vector<std::vector<bool>> _hl_rows;
+    void _UpdateHlRows(int row, _Line &);
+    void _InvalidateHlRows(unsigned hl_id);
+
+    // The scrolling collected before and after flushing
+    ScrollRegion _pending_scroll, _flushed_scroll;
+    static void _MergeScroll(ScrollRegion &to, const ScrollRegion &);
 
     // Make sure flush requests are executed not too frequently,
     // but cleanly.
+    FlushPolicy _flush_policy;
     ClockT::time_point _last_flush_time;
     // Rendering is done asyncrhonously and concurrently, make sure only clean
     // state after Flush() is displayed.
@@ -7,13 +7,14 @@
 void Session::_Init(uv_stream_t *in, uv_stream_t *out)
 {
     auto onError = [this](const char *error) { _OnError(error); };
+    _exec.reset(new AsyncExec{&_loop});
     _rpc.reset(new MsgPackRpc(in, out, onError));
-    _renderer.reset(new Renderer{&_loop, _rpc.get()});
+    _renderer.reset(new Renderer{*_exec, _rpc.get()});
     _redraw_handler.reset(new RedrawHandler{_rpc.get(), _renderer.get()});
 
     _redraw_handler->AttachUI();
 
-    _input.reset(new Input{&_loop, _rpc.get()});
+    _input.reset(new Input{*_exec, _rpc.get()});
 }
 
 void Session::SetWindow(IWindow *window)
@@ -39,6 +39,8 @@ public:
     }
 
 protected:
+    // The tasks from the other threads, shared by the renderer and the input
+    std::unique_ptr<AsyncExec> _exec;
     std::unique_ptr<MsgPackRpc> _rpc;
     std::unique_ptr<Renderer> _renderer;
     std::unique_ptr<RedrawHandler> _redraw_handler;
@@ -0,0 +1,128 @@
+#include "SlabPool.hpp"
+
+
+// The free blocks of the shared pool kept by a thread. They're given back
+// when the thread finishes, the shared pool is never destroyed.
+struct SlabPool::_ThreadCache
+{
+    std::array<_FreeBlock *, SIZE_CLASSES> free{};
+    std::array<size_t, SIZE_CLASSES> count{};
+
+    ~_ThreadCache()
+    {
+        for (size_t size_class = 0; size_class < SIZE_CLASSES; ++size_class)
+            Shared()._Drain(*this, size_class, count[size_class]);
+    }
+};
+
+SlabPool& SlabPool::Shared()
+{
+    static SlabPool *pool = [] {
+        auto *pool = new SlabPool;
+        pool->_has_thread_caches = true;
+        return pool;
+    }();
+    return *pool;
+}
+
+SlabPool::_ThreadCache& SlabPool::_GetThreadCache()
+{
+    thread_local _ThreadCache cache;
+    return cache;
+}
+
+void* SlabPool::Allocate(size_t size)
+{
+    size_t size_class = _GetSizeClass(size);
+    if (!_has_thread_caches)
+    {
+        std::lock_guard<std::mutex> guard{_mutex};
+        return _Pop(size_class);
+    }
+
+    auto &cache = _GetThreadCache();
+    if (!cache.free[size_class])
+        _Refill(cache, size_class);
+    _FreeBlock *block = cache.free[size_class];
+    cache.free[size_class] = block->next;
+    --cache.count[size_class];
+    return block;
+}
+
+void SlabPool::Deallocate(void *p, size_t size)
+{
+    size_t size_class = _GetSizeClass(size);
+    auto *block = static_cast<_FreeBlock *>(p);
+    if (!_has_thread_caches)
+    {
+        std::lock_guard<std::mutex> guard{_mutex};
+        block->next = _free[size_class];
+        _free[size_class] = block;
+        return;
+    }
+
+    auto &cache = _GetThreadCache();
+    block->next = cache.free[size_class];
+    cache.free[size_class] = block;
+    // The blocks allocated by one thread and freed by another flow back
+    // to the pool, keep a batch for the following allocations.
+    if (++cache.count[size_class] >= 2 * CACHE_BATCH)
+        _Drain(cache, size_class, CACHE_BATCH);
+}
+
+size_t SlabPool::GetSlabCount()
+{
+    std::lock_guard<std::mutex> guard{_mutex};
+    return _slabs.size();
+}
+
+void SlabPool::_AddSlab(size_t size_class)
+{
+    size_t block_size = (size_class + 1) * GRANULARITY;
+    auto &slab = _slabs.emplace_back(new std::byte[SLAB_SIZE]);
+    // Thread the new blocks into the free list
+    for (size_t i = 0; i < SLAB_SIZE / block_size; ++i)
+    {
+        auto *block = reinterpret_cast<_FreeBlock *>(slab.get() + i * block_size);
+        block->next = _free[size_class];
+        _free[size_class] = block;
+    }
+}
+
+SlabPool::_FreeBlock* SlabPool::_Pop(size_t size_class)
+{
+    if (!_free[size_class])
+        _AddSlab(size_class);
+    _FreeBlock *block = _free[size_class];
+    _free[size_class] = block->next;
+    return block;
+}
+
+void SlabPool::_Refill(_ThreadCache &cache, size_t size_class)
+{
+    std::lock_guard<std::mutex> guard{_mutex};
+    for (size_t i = 0; i < CACHE_BATCH; ++i)
+    {
+        _FreeBlock *block = _Pop(size_class);
+        block->next = cache.free[size_class];
+        cache.free[size_class] = block;
+    }
+    cache.count[size_class] += CACHE_BATCH;
+}
+
+void SlabPool::_Drain(_ThreadCache &cache, size_t size_class, size_t count)
+{
+    if (!count)
+        return;
+    // Detach the first count blocks of the cache, then splice them in under the lock
+    _FreeBlock *first = cache.free[size_class];
+    _FreeBlock *last = first;
+    for (size_t i = 1; i < count; ++i)
+        last = last->next;
+    cache.free[size_class] = last->next;
+    cache.count[size_class] -= count;
+
+    std::lock_guard<std::mutex> guard{_mutex};
+    last->next = _free[size_class];
+    _free[size_class] = first;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+// A pool of small fixed size blocks carved from big slabs. The freed blocks
+// are recycled by size, so the steady state doesn't touch the heap at all.
+// The blocks may be freed by any thread, hence the lock.
+class SlabPool
+{
+public:
+    // The pool for the objects shared between the threads. It's never destroyed
+    // because the objects may be still alive during the static destruction.
+    // Every thread keeps a few free blocks of the shared pool to itself,
+    // the lock is only taken to move them to or from the pool in batches.
+    static SlabPool& Shared();
+
+    static constexpr size_t GRANULARITY = 16;
+    // Big enough for the coroutine frames
+    static constexpr size_t MAX_BLOCK_SIZE = 1024;
+    static constexpr size_t SLAB_SIZE = 64 * 1024;
+    // The count of blocks moved between a thread cache and the pool at once
+    static constexpr size_t CACHE_BATCH = 32;
+
+    void* Allocate(size_t size);
+    void Deallocate(void *, size_t size);
+
+    size_t GetSlabCount();
+
+private:
+    struct _FreeBlock
+    {
+        _FreeBlock *next;
+    };
+
+    static constexpr size_t SIZE_CLASSES = MAX_BLOCK_SIZE / GRANULARITY;
+
+    std::mutex _mutex;
+    // Free lists by the size class
+    std::array<_FreeBlock *, SIZE_CLASSES> _free{};
+    std::vector<std::unique_ptr<std::byte[]>> _slabs;
+
+    // Only the shared pool outlives the threads, so only it has the thread caches
+    bool _has_thread_caches = false;
+    struct _ThreadCache;
+    static _ThreadCache& _GetThreadCache();
+
+    static size_t _GetSizeClass(size_t size) { return (size + GRANULARITY - 1) / GRANULARITY - 1; }
+    void _AddSlab(size_t size_class);
+    // Under the lock
+    _FreeBlock* _Pop(size_t size_class);
+    // Move a batch of blocks from the pool to the cache and back
+    void _Refill(_ThreadCache &, size_t size_class);
+    void _Drain(_ThreadCache &, size_t size_class, size_t count);
+};
+
+// An allocator for std::allocate_shared(), the containers and the like.
+// The small blocks go to the shared slab pool, the big ones go to the heap.
+template <typename T>
+struct SlabAllocator
+{
+    using value_type = T;
+
+    static_assert(alignof(T) <= SlabPool::GRANULARITY);
+
+    SlabAllocator() = default;
+    template <typename U>
+    SlabAllocator(const SlabAllocator<U> &) {}
+
+    T* allocate(size_t n)
+    {
+        if (n && n * sizeof(T) <= SlabPool::MAX_BLOCK_SIZE)
+            return static_cast<T *>(SlabPool::Shared().Allocate(n * sizeof(T)));
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        if (n && n * sizeof(T) <= SlabPool::MAX_BLOCK_SIZE)
+            SlabPool::Shared().Deallocate(p, n * sizeof(T));
+        else
+            ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const SlabAllocator<U> &) const { return true; }
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A move-only void() callable. The small captures, like a couple of pointers
+// and integers, are stored inline, only the bigger ones go to the heap.
+class SmallTask
+{
+public:
+    static constexpr size_t CAPACITY = 48;
+
+    SmallTask() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, SmallTask>>>
+    SmallTask(F &&f)
+    {
+        using T = std::decay_t<F>;
+        if constexpr (_IsInline<T>())
+        {
+            new (_storage) T(std::forward<F>(f));
+            _ops = &_inline_ops<T>;
+        }
+        else
+        {
+            new (_storage) T*(new T(std::forward<F>(f)));
+            _ops = &_heap_ops<T>;
+        }
+    }
+
+    SmallTask(SmallTask &&o) noexcept
+        : _ops{o._ops}
+    {
+        if (_ops)
+            _ops->move(_storage, o._storage);
+        o._ops = nullptr;
+    }
+
+    SmallTask& operator=(SmallTask &&o) noexcept
+    {
+        if (this != &o)
+        {
+            _Reset();
+            _ops = o._ops;
+            if (_ops)
+                _ops->move(_storage, o._storage);
+            o._ops = nullptr;
+        }
+        return *this;
+    }
+
+    ~SmallTask()
+    {
+        _Reset();
+    }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+    void operator()()
+    {
+        _ops->call(_storage);
+    }
+
+private:
+    struct _Ops
+    {
+        void (*call)(void *);
+        // Move construct into dst and destroy src
+        void (*move)(void *dst, void *src);
+        void (*destroy)(void *);
+    };
+
+    template <typename T>
+    static constexpr bool _IsInline()
+    {
+        return sizeof(T) <= CAPACITY && alignof(T) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<T>;
+    }
+
+    template <typename T>
+    static constexpr _Ops _inline_ops{
+        [](void *p) { (*static_cast<T *>(p))(); },
+        [](void *dst, void *src) {
+            new (dst) T(std::move(*static_cast<T *>(src)));
+            static_cast<T *>(src)->~T();
+        },
+        [](void *p) { static_cast<T *>(p)->~T(); },
+    };
+
+    template <typename T>
+    static constexpr _Ops _heap_ops{
+        [](void *p) { (**static_cast<T **>(p))(); },
+        [](void *dst, void *src) { new (dst) T*(*static_cast<T **>(src)); },
+        [](void *p) { delete *static_cast<T **>(p); },
+    };
+
+    alignas(std::max_align_t) std::byte _storage[CAPACITY];
+    const _Ops *_ops = nullptr;
+
+    void _Reset()
+    {
+        if (_ops)
+            _ops->destroy(_storage);
+        _ops = nullptr;
+    }
+};
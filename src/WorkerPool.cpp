@@ -0,0 +1,93 @@
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(unsigned threads)
+    : _thread_count{threads}
+{
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> guard{_mutex};
+        _stop = true;
+    }
+    _start_cv.notify_all();
+    for (auto &t : _threads)
+        t.join();
+}
+
+void WorkerPool::_ParallelFor(size_t count, void *job, _CallT call)
+{
+    if (!_thread_count || count < 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+            call(job, i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard{_mutex};
+        if (_threads.empty())
+        {
+            for (unsigned i = 1; i <= _thread_count; ++i)
+                _threads.emplace_back([this, i] { _Run(i); });
+        }
+        _job = job;
+        _call = call;
+        _count = count;
+        _next = 0;
+        _error = nullptr;
+        _busy = _thread_count;
+        ++_generation;
+    }
+    _start_cv.notify_all();
+
+    _Work(0);
+
+    std::unique_lock<std::mutex> lock{_mutex};
+    _done_cv.wait(lock, [this] { return !_busy; });
+    _job = nullptr;
+    if (_error)
+        std::rethrow_exception(std::exchange(_error, nullptr));
+}
+
+void WorkerPool::_Run(unsigned worker)
+{
+    unsigned generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _start_cv.wait(lock, [&] { return _stop || _generation != generation; });
+            if (_stop)
+                return;
+            generation = _generation;
+        }
+
+        _Work(worker);
+
+        {
+            std::lock_guard<std::mutex> guard{_mutex};
+            --_busy;
+        }
+        _done_cv.notify_one();
+    }
+}
+
+void WorkerPool::_Work(unsigned worker)
+{
+    // Take the jobs one by one: the rows may differ much in cost.
+    for (size_t i = _next++; i < _count; i = _next++)
+    {
+        try
+        {
+            _call(_job, i, worker);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> guard{_mutex};
+            if (!_error)
+                _error = std::current_exception();
+        }
+    }
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small pool of persistent threads to spread a batch of independent jobs.
+// The calling thread takes part in the work too, so a pool without threads
+// just runs the jobs serially. The threads are started on the first batch.
+class WorkerPool
+{
+public:
+    // The number of the extra threads besides the calling one
+    explicit WorkerPool(unsigned threads);
+    ~WorkerPool();
+
+    // The jobs get the worker index in [0, GetWorkerCount()) to use per worker state.
+    unsigned GetWorkerCount() const { return _thread_count + 1; }
+
+    // Run job(index, worker) for every index in [0, count), return when all of them are done.
+    // The first exception thrown by a job is rethrown here. The job is only referenced
+    // during the call, it's neither copied nor stored.
+    template <typename JobT>
+    void ParallelFor(size_t count, JobT &&job)
+    {
+        using FuncT = std::remove_reference_t<JobT>;
+        auto call = [](void *job, size_t index, unsigned worker) {
+            (*static_cast<FuncT *>(job))(index, worker);
+        };
+        _ParallelFor(count, const_cast<void *>(static_cast<const void *>(std::addressof(job))), call);
+    }
+
+private:
+    unsigned _thread_count;
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _start_cv;
+    std::condition_variable _done_cv;
+    // Every batch bumps the generation to wake up the threads
+    unsigned _generation = 0;
+    // The threads that haven't finished the current batch yet
+    unsigned _busy = 0;
+    bool _stop = false;
+
+    using _CallT = void (*)(void *job, size_t index, unsigned worker);
+    void *_job = nullptr;
+    _CallT _call = nullptr;
+    size_t _count = 0;
+    std::atomic<size_t> _next{0};
+    std::exception_ptr _error;
+
+    void _ParallelFor(size_t count, void *job, _CallT);
+    void _Run(unsigned worker);
+    void _Work(unsigned worker);
+};
@@ -0,0 +1,228 @@
+#include <boost/ut.hpp>
+#include "AllocCounter.hpp"
+#include <msgpack.hpp>
+#include <uv.h>
+#define private public
+#include "../src/Renderer.hpp"
+#include "../src/Input.hpp"
+#include "../src/MsgPackRpc.hpp"
+#undef private
+#include <chrono>
+#include <cstdio>
+
+// The allocation budgets of the hot paths in the steady state.
+// Run `meson test --benchmark -v alloc` to see the time of the operations too.
+
+namespace {
+
+using namespace boost::ut;
+
+// The count of repetitions of every operation
+const int N = 1000;
+
+// Print the average time of the operations done during the lifetime
+class Timing
+{
+public:
+    Timing(const char *name, int count)
+        : _name{name}
+        , _count{count}
+    {
+    }
+
+    ~Timing()
+    {
+        std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - _start;
+        std::printf("%s: %.3f us per operation\n", _name, elapsed.count() / _count);
+    }
+
+private:
+    const char *_name;
+    int _count;
+    std::chrono::steady_clock::time_point _start = std::chrono::steady_clock::now();
+};
+
+suite s = [] {
+    "alloc"_test = [] {
+        uv_loop_t loop;
+        uv_loop_init(&loop);
+
+        "GridLine"_test = [&] {
+            AsyncExec exec{&loop};
+            Renderer renderer{exec, nullptr};
+            AllocCounter counter;
+            Timing timing{"GridLine", N};
+            for (int i = 0; i < N; ++i)
+            {
+                int row = i % renderer.GetHeight();
+                renderer.GridLine(row, 0, "a", 1, 40);
+                renderer.GridLine(row, 40, " ", 0, 40);
+            }
+            expect(0_u == counter.GetCount()) << counter.GetCount();
+        };
+
+        "GridScroll"_test = [&] {
+            AsyncExec exec{&loop};
+            Renderer renderer{exec, nullptr};
+            AllocCounter counter;
+            Timing timing{"GridScroll", N};
+            for (int i = 0; i < N; ++i)
+                renderer.GridScroll(0, renderer.GetHeight() - 1, 0, renderer.GetWidth(), i % 2 ? 1 : -1);
+            expect(0_u == counter.GetCount()) << counter.GetCount();
+        };
+
+        "SplitChunks"_test = [&] {
+            // A typical row of code: words, single spaces and indentation
+            ChunkSplitter splitter;
+            const char *text = "        for (int i = 0; i < N; ++i)  // comment ";
+            auto split = [&] {
+                uint32_t *cells = splitter.GetCells(300);
+                for (size_t i = 0; i < 300; ++i)
+                    cells[i] = ChunkSplitter::Pack(i / 7 % 3, text[i % 48] == ' ');
+                return splitter.Split().size();
+            };
+            split();
+            AllocCounter counter;
+            Timing timing{"SplitChunks", N};
+            size_t chunks{};
+            for (int i = 0; i < N; ++i)
+                chunks += split();
+            expect(chunks > 0_u);
+            expect(0_u == counter.GetCount()) << counter.GetCount();
+        };
+
+        "Flush_no_damage"_test = [&] {
+            AsyncExec exec{&loop};
+            Renderer renderer{exec, nullptr};
+            auto flush = [&] {
+                renderer._is_clean = true;
+                renderer._DoFlush();
+            };
+            // The first flush prepares everything
+            flush();
+            AllocCounter counter{AllocCounter::ALL_THREADS};
+            Timing timing{"Flush_no_damage", N};
+            for (int i = 0; i < N; ++i)
+            {
+                renderer.GridCursorGoto(i % renderer.GetHeight(), i % renderer.GetWidth());
+                flush();
+            }
+            expect(0_u == counter.GetCount()) << counter.GetCount();
+        };
+
+        "Flush_full_damage"_test = [&] {
+            AsyncExec exec{&loop};
+            Renderer renderer{exec, nullptr};
+            expect(renderer.GetHeight() >= Renderer::PARALLEL_MIN_ROWS);
+            // Every row is rewritten with words longer than a short string,
+            // the text classes alternating to split them into several words.
+            auto redraw = [&](int i) {
+                for (int row = 0; row < renderer.GetHeight(); ++row)
+                {
+                    for (int col = 0; col < renderer.GetWidth(); col += 20)
+                    {
+                        renderer.GridLine(row, col, i % 2 ? "x" : "y", col / 20 % 3, 18);
+                        renderer.GridLine(row, col + 18, " ", 0, 2);
+                    }
+                }
+                renderer._is_clean = true;
+                renderer._DoFlush();
+            };
+            // The previous frame is kept alive by the window, let two of them warm up the pool
+            redraw(0);
+            redraw(1);
+            // The rows are built on the worker threads too
+            AllocCounter counter{AllocCounter::ALL_THREADS};
+            Timing timing{"Flush_full_damage", N / 10};
+            for (int i = 0; i < N / 10; ++i)
+                redraw(i);
+            expect(0_u == counter.GetCount()) << counter.GetCount();
+        };
+
+        "Input_Accept"_test = [&] {
+            uv_file fds[2];
+            expect(0 == uv_pipe(fds, 0, 0));
+            uv_pipe_t out, in;
+            uv_pipe_init(&loop, &out, 0);
+            uv_pipe_open(&out, fds[1]);
+            uv_pipe_init(&loop, &in, 0);
+            uv_pipe_open(&in, fds[0]);
+            {
+                MsgPackRpc rpc{reinterpret_cast<uv_stream_t *>(&out), reinterpret_cast<uv_stream_t *>(&in), [](const char *) { }};
+                AsyncExec exec{&loop};
+                Input input{exec, &rpc};
+                auto accept = [&] {
+                    uint32_t seq = rpc._seq;
+                    input.Accept("<C-x>");
+                    // The input coroutine sends the request and awaits the response
+                    uv_run(&loop, UV_RUN_NOWAIT);
+                    rpc._Complete(seq, msgpack::object{}, msgpack::object{5});
+                };
+                // Warm up the pools of the writes, of the queue nodes and of the coroutine frames
+                for (int i = 0; i < 10; ++i)
+                    accept();
+                AllocCounter counter;
+                Timing timing{"Input_Accept", N};
+                for (int i = 0; i < N; ++i)
+                    accept();
+                // The callable is stored inline, the queue node and
+                // the coroutine frame come from the slab pool
+                expect(0_u == counter.GetCount()) << counter.GetCount();
+            }
+            auto close = [](uv_pipe_t &pipe) {
+                uv_close(reinterpret_cast<uv_handle_t *>(&pipe), nullptr);
+            };
+            close(in);
+            close(out);
+            // The pipes are about to go out of scope
+            uv_run(&loop, UV_RUN_DEFAULT);
+        };
+
+        "MsgPackRpc_Request"_test = [&] {
+            uv_file fds[2];
+            expect(0 == uv_pipe(fds, 0, 0));
+            uv_pipe_t out, in;
+            uv_pipe_init(&loop, &out, 0);
+            uv_pipe_open(&out, fds[1]);
+            uv_pipe_init(&loop, &in, 0);
+            uv_pipe_open(&in, fds[0]);
+            {
+                MsgPackRpc rpc{reinterpret_cast<uv_stream_t *>(&out), reinterpret_cast<uv_stream_t *>(&in), [](const char *) { }};
+                auto request = [&] {
+                    uint32_t seq = rpc._seq;
+                    rpc.Request(
+                        [](MsgPackRpc::PackerT &pk) {
+                            pk.pack("nvim_input");
+                            pk.pack_array(1);
+                            pk.pack("x");
+                        },
+                        [](const msgpack::object &, const msgpack::object &) { });
+                    // Let the requests be written, and pretend they're answered
+                    uv_run(&loop, UV_RUN_NOWAIT);
+                    rpc._Complete(seq, msgpack::object{}, msgpack::object{});
+                };
+                // Warm up the pool of the writes
+                for (int i = 0; i < 10; ++i)
+                    request();
+                AllocCounter counter;
+                Timing timing{"MsgPackRpc_Request", N};
+                for (int i = 0; i < N; ++i)
+                    request();
+                // The pending requests, the writes and their buffers are all reused
+                expect(0_u == counter.GetCount()) << counter.GetCount();
+            }
+            auto close = [](uv_pipe_t &pipe) {
+                uv_close(reinterpret_cast<uv_handle_t *>(&pipe), nullptr);
+            };
+            close(in);
+            close(out);
+            // The pipes are about to go out of scope
+            uv_run(&loop, UV_RUN_DEFAULT);
+        };
+
+        uv_run(&loop, UV_RUN_DEFAULT);
+        uv_loop_close(&loop);
+    };
+};
+
+} //namespace;
@@ -0,0 +1,69 @@
+#include "AllocCounter.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Usually only the allocations of the current thread are counted,
+// the libuv threads and the like don't interfere then.
+// The over-aligned allocations aren't counted, they're rare.
+thread_local size_t allocation_count = 0;
+std::atomic<size_t> total_allocation_count{0};
+
+void Count()
+{
+    ++allocation_count;
+    total_allocation_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t GetCount(AllocCounter::Scope scope)
+{
+    return scope == AllocCounter::THIS_THREAD
+        ? allocation_count
+        : total_allocation_count.load(std::memory_order_relaxed);
+}
+
+void* Allocate(std::size_t size)
+{
+    Count();
+    if (void *p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+} //namespace;
+
+AllocCounter::AllocCounter(Scope scope)
+    : _scope{scope}
+    , _start{::GetCount(scope)}
+{
+}
+
+size_t AllocCounter::GetCount() const
+{
+    return ::GetCount(_scope) - _start;
+}
+
+void* operator new(std::size_t size) { return Allocate(size); }
+void* operator new[](std::size_t size) { return Allocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    Count();
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    Count();
+    return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { std::free(p); }
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+// Counts the heap allocations done while alive by the current thread,
+// or by all the threads if the work is spread over a pool of threads.
+// The global operator new is replaced in the tests, see AllocCounter.cpp.
+class AllocCounter
+{
+public:
+    enum Scope
+    {
+        THIS_THREAD,
+        ALL_THREADS,
+    };
+
+    AllocCounter(Scope = THIS_THREAD);
+
+    size_t GetCount() const;
+
+private:
+    Scope _scope;
+    size_t _start;
+};
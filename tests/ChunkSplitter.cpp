@@ -0,0 +1,89 @@
+#include <boost/ut.hpp>
+#include "../src/ChunkSplitter.hpp"
+#include <random>
+
+namespace {
+
+using namespace boost::ut;
+
+// The original cell by cell splitting for reference
+std::vector<size_t> SplitReference(const std::vector<unsigned> &hl, const std::vector<bool> &space)
+{
+    std::vector<size_t> chunks{0, 1};
+    bool is_space = false;
+    while (chunks.back() < hl.size())
+    {
+        size_t back = chunks.back();
+        if (hl[back] != hl[chunks[chunks.size() - 2]])
+        {
+            chunks.push_back(back + 1);
+            is_space = false;
+        }
+        else if (!is_space && back > 0 && space[back] && space[back - 1])
+        {
+            is_space = true;
+            if (back > 1)
+            {
+                chunks.back() = back - 1;
+                if (chunks[chunks.size() - 2] == chunks.back())
+                    chunks.resize(chunks.size() - 1);
+                chunks.push_back(back + 1);
+            }
+        }
+        else if (is_space && !space[back])
+        {
+            is_space = false;
+            chunks.push_back(back + 1);
+        }
+        else
+            ++chunks.back();
+    }
+    return chunks;
+}
+
+suite s = [] {
+    "ChunkSplitter"_test = [] {
+        "empty"_test = [] {
+            ChunkSplitter splitter;
+            splitter.GetCells(0);
+            expect(splitter.Split() == std::vector<size_t>{0, 1});
+        };
+
+        "spaces"_test = [] {
+            ChunkSplitter splitter;
+            // "a  b c   "
+            const char *text = "a  b c   ";
+            uint32_t *cells = splitter.GetCells(9);
+            for (size_t i = 0; i < 9; ++i)
+                cells[i] = ChunkSplitter::Pack(1, text[i] == ' ');
+            expect(splitter.Split() == std::vector<size_t>{0, 1, 3, 6, 9});
+        };
+
+        "random"_test = [] {
+            std::mt19937 gen{42};
+            ChunkSplitter splitter;
+            int mismatches{};
+            for (int i = 0; i < 10000; ++i)
+            {
+                // Varying lengths check the padding left by the longer rows too
+                size_t count = gen() % 40;
+                unsigned classes = 1 + gen() % 3;
+                std::vector<unsigned> hl(count);
+                std::vector<bool> space(count);
+                uint32_t *cells = splitter.GetCells(count);
+                for (size_t col = 0; col < count; ++col)
+                {
+                    hl[col] = gen() % classes;
+                    space[col] = gen() % 2;
+                    cells[col] = ChunkSplitter::Pack(hl[col], space[col]);
+                }
+                auto expected = SplitReference(hl, space);
+                if (splitter.Split() != expected || splitter.SplitScalar() != expected)
+                    ++mismatches;
+            }
+            expect(0_i == mismatches);
+        };
+    };
+};
+
+} //namespace;
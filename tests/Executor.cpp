@@ -0,0 +1,128 @@
+#include <boost/ut.hpp>
+#include "../src/AsyncExec.hpp"
+#include "../src/MpscQueue.hpp"
+#include "../src/SmallTask.hpp"
+#include <array>
+#include <string>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace boost::ut;
+using namespace std::string_literals;
+
+suite s = [] {
+    "SmallTask"_test = [] {
+        "inline"_test = [] {
+            int calls{};
+            SmallTask task{[&calls] { ++calls; }};
+            SmallTask moved{std::move(task)};
+            expect(!task);
+            moved();
+            expect(1_i == calls);
+        };
+
+        "heap"_test = [] {
+            // Too big to be stored inline, and owning a resource
+            auto counter = std::make_shared<int>(0);
+            std::array<char, 2 * SmallTask::CAPACITY> big{};
+            {
+                SmallTask task{[counter, big] { *counter += 1 + big[0]; }};
+                SmallTask other;
+                other = std::move(task);
+                other();
+                expect(2 == counter.use_count());
+            }
+            expect(1_i == *counter);
+            expect(1 == counter.use_count());
+        };
+    };
+
+    "MpscQueue"_test = [] {
+        MpscQueue<int> queue;
+        const int THREADS = 4;
+        const int COUNT = 10000;
+        std::vector<std::thread> producers;
+        for (int t = 0; t < THREADS; ++t)
+        {
+            producers.emplace_back([&, t] {
+                for (int i = 0; i < COUNT; ++i)
+                    queue.Push(t * COUNT + i);
+            });
+        }
+
+        // Every element is taken once, and the order of every producer is kept
+        std::vector<int> last(THREADS, -1);
+        int popped{}, disorders{};
+        while (popped < THREADS * COUNT)
+        {
+            int value;
+            if (!queue.TryPop(value))
+                continue;
+            ++popped;
+            int t = value / COUNT;
+            if (value % COUNT != last[t] + 1)
+                ++disorders;
+            last[t] = value % COUNT;
+        }
+        for (auto &p : producers)
+            p.join();
+        expect(0_i == disorders);
+        int value;
+        expect(!queue.TryPop(value));
+    };
+
+    "AsyncExec"_test = [] {
+        uv_loop_t loop;
+        uv_loop_init(&loop);
+
+        "threads"_test = [&] {
+            AsyncExec exec{&loop};
+            int executed{};
+            std::vector<std::thread> producers;
+            for (int t = 0; t < 4; ++t)
+            {
+                producers.emplace_back([&] {
+                    for (int i = 0; i < 100; ++i)
+                        exec.Post(Executor::HOUSEKEEPING, [&] { ++executed; });
+                });
+            }
+            for (auto &p : producers)
+                p.join();
+            expect(400_u == exec.GetStats(Executor::HOUSEKEEPING).depth);
+
+            while (executed < 400)
+                uv_run(&loop, UV_RUN_NOWAIT);
+            auto stats = exec.GetStats(Executor::HOUSEKEEPING);
+            expect(0_u == stats.depth);
+            expect(stats.max_depth > 0_u);
+            expect(400_u == stats.executed);
+            expect(stats.max_latency <= stats.total_latency);
+            expect(0_u == exec.GetStats(Executor::INPUT).executed);
+        };
+
+        "priority"_test = [&] {
+            AsyncExec exec{&loop};
+            std::string order;
+            exec.Post(Executor::HOUSEKEEPING, [&] {
+                order += 'a';
+                // Jumps ahead of the housekeeping posted before
+                exec.Post(Executor::INPUT, [&] { order += 'i'; });
+            });
+            exec.Post(Executor::HOUSEKEEPING, [&] { order += 'b'; });
+            exec.Post(Executor::RESIZE, [&] { order += 'r'; });
+            exec.Post(Executor::PRESENT, [&] { order += 'p'; });
+            exec.Post(Executor::INPUT, [&] { order += 'j'; });
+            while (order.size() < 6)
+                uv_run(&loop, UV_RUN_NOWAIT);
+            expect("jpraib"s == order);
+        };
+
+        uv_run(&loop, UV_RUN_DEFAULT);
+        uv_loop_close(&loop);
+    };
+};
+
+} //namespace;
@@ -0,0 +1,44 @@
+#include <boost/ut.hpp>
+#include "../src/FlushPolicy.hpp"
+
+namespace {
+
+using namespace boost::ut;
+using namespace std::chrono_literals;
+
+suite s = [] {
+    "FlushPolicy"_test = [] {
+        "idle"_test = [] {
+            FlushPolicy policy{16ms};
+            auto now = ClockT::now();
+            expect(policy.GetDelay(now, now - 20ms) == 0ms);
+            expect(policy.GetDelay(now, now - 10ms) == 6ms);
+        };
+
+        "input"_test = [] {
+            FlushPolicy policy{16ms};
+            auto now = ClockT::now();
+            policy.NotifyInput(now - 10ms);
+            expect(policy.GetDelay(now, now - 1ms) == 0ms);
+            // The input isn't recent anymore
+            expect(policy.GetDelay(now + 200ms, now + 199ms) == 15ms);
+        };
+
+        "expensive"_test = [] {
+            FlushPolicy policy{16ms};
+            for (int i = 0; i < 32; ++i)
+            {
+                policy.ReportFlushCost(30ms);
+                policy.ReportPresentCost(20ms);
+            }
+            expect(policy.GetFrameCost() > 45ms);
+            auto now = ClockT::now();
+            // Expensive frames aren't presented immediately even after input
+            policy.NotifyInput(now);
+            expect(policy.GetInterval(now) > 90ms);
+            expect(policy.GetInterval(now) <= FlushPolicy::MAX_INTERVAL);
+        };
+    };
+};
+
+} //namespace;
@@ -0,0 +1,112 @@
+#include <boost/ut.hpp>
+#include "../src/HlTable.hpp"
+
+namespace {
+
+using namespace boost::ut;
+
+suite s = [] {
+    "HlTable"_test = [] {
+        "classes"_test = [] {
+            HlTable table;
+            HlAttr red;
+            red.fg = 0xff0000;
+            expect(table.Define(1, red));
+            expect(table.Define(2, red));
+            // The same definition again
+            expect(!table.Define(2, red));
+            expect(table.GetClass(1) == table.GetClass(2));
+            expect(0_u == table.GetClass(3));
+            expect(table[table.GetClass(1)].pango_style == " color=\"#ff0000\"");
+        };
+
+        "reverse"_test = [] {
+            HlTable table;
+            table.SetDefault(0xaaaaaa, 0x111111);
+            HlAttr rev;
+            rev.flags = HlAttr::F_REVERSE;
+            table.Define(1, rev);
+            const auto &entry = table[table.GetClass(1)];
+            expect(0x111111_u == entry.fg);
+            expect(0xaaaaaa_u == entry.bg);
+            expect(!entry.IsSpaceInvisible());
+            expect(entry.DependsOnDefault());
+
+            expect(!table.SetDefault(0xaaaaaa, 0x111111));
+            expect(table.SetDefault(0xbbbbbb, 0x111111));
+            expect(0xbbbbbb_u == table[table.GetClass(1)].bg);
+        };
+
+        "text_class"_test = [] {
+            HlTable table;
+            HlAttr red, red_on_blue, curl;
+            red.fg = 0xff0000;
+            red_on_blue.fg = 0xff0000;
+            red_on_blue.bg = 0x0000ff;
+            curl.flags = HlAttr::F_UNDERCURL;
+            table.Define(1, red);
+            table.Define(2, red_on_blue);
+            table.Define(3, curl);
+            // The background is filled separately, the text looks the same
+            expect(table.GetClass(1) != table.GetClass(2));
+            expect(table.GetTextClass(1) == table.GetTextClass(2));
+            expect(table.GetText(table.GetTextClass(2)).pango_style == " color=\"#ff0000\"");
+            expect(0x0000ff_u == table[table.GetClass(2)].bg);
+            expect(0_u == table.GetTextClass(4));
+            expect(!table.GetText(table.GetTextClass(1)).has_decoration);
+            expect(table.GetText(table.GetTextClass(3)).has_decoration);
+        };
+
+        "compact"_test = [] {
+            HlTable table;
+            HlAttr rev;
+            rev.flags = HlAttr::F_REVERSE;
+            // A color scheme after color scheme redefines the same ids
+            bool compacted{};
+            for (uint32_t scheme = 1; scheme <= 10; ++scheme)
+            {
+                for (unsigned hl_id = 1; hl_id <= 4; ++hl_id)
+                {
+                    HlAttr attr;
+                    attr.fg = scheme * 0x10 + hl_id;
+                    table.Define(hl_id, attr);
+                }
+                table.Define(5, rev);
+                table.SetDefault(scheme, 0);
+                compacted |= table.Compact();
+            }
+            // Only the classes in use are left, and the default one
+            expect(table.GetClassCount() <= 2 * 6_u) << table.GetClassCount();
+            expect(compacted);
+            expect(!table.Compact());
+            expect(0_u == table.GetClass(0));
+            expect(table.GetText(0).pango_style.empty());
+            for (unsigned hl_id = 1; hl_id <= 4; ++hl_id)
+            {
+                expect(table[table.GetClass(hl_id)].fg == 10 * 0x10 + hl_id);
+                expect(table.GetText(table.GetTextClass(hl_id)).pango_style == table[table.GetClass(hl_id)].pango_style);
+            }
+            expect(0_u == table[table.GetClass(5)].fg);
+            expect(10_u == table[table.GetClass(5)].bg);
+            expect(table.GetText(table.GetTextClass(5)).pango_style == " color=\"#000000\"");
+        };
+
+        "invisible_space"_test = [] {
+            HlTable table;
+            HlAttr fg, bg, curl;
+            fg.fg = 0xff0000;
+            bg.bg = 0x00ff00;
+            curl.flags = HlAttr::F_UNDERCURL;
+            table.Define(1, fg);
+            table.Define(2, bg);
+            table.Define(3, curl);
+            expect(table[0].IsSpaceInvisible());
+            expect(table[table.GetClass(1)].IsSpaceInvisible());
+            expect(!table[table.GetClass(2)].IsSpaceInvisible());
+            expect(!table[table.GetClass(3)].IsSpaceInvisible());
+            expect(table[table.GetClass(3)].HasDecoration());
+        };
+    };
+};
+
+} //namespace;
@@ -0,0 +1,96 @@
+#include <boost/ut.hpp>
+#include "../src/LruCache.hpp"
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace boost::ut;
+
+suite s = [] {
+    "LruCache"_test = [] {
+        "eviction_order"_test = [] {
+            std::vector<std::string> evicted;
+            LruCache<int, std::string> cache{3, [&](std::string &v) { evicted.push_back(v); }};
+            cache.Put(1, "a");
+            cache.Put(2, "b");
+            cache.Put(3, "c");
+            expect(3_u == cache.GetSize());
+            expect(evicted.empty());
+            // The least recently put goes first
+            cache.Put(4, "d");
+            expect(std::vector<std::string>{"a"} == evicted);
+            cache.Put(5, "e");
+            expect(std::vector<std::string>{"a", "b"} == evicted);
+            expect(3_u == cache.GetSize());
+        };
+
+        "put_again"_test = [] {
+            std::vector<std::string> evicted;
+            LruCache<int, std::string> cache{2, [&](std::string &v) { evicted.push_back(v); }};
+            cache.Put(1, "a");
+            cache.Put(2, "b");
+            // The replaced value is released, the key becomes the most recent
+            cache.Put(1, "A");
+            expect(std::vector<std::string>{"a"} == evicted);
+            cache.Put(3, "c");
+            expect(std::vector<std::string>{"a", "b"} == evicted);
+            expect(2_u == cache.GetSize());
+        };
+
+        "take"_test = [] {
+            std::vector<std::string> evicted;
+            LruCache<int, std::string> cache{3, [&](std::string &v) { evicted.push_back(v); }};
+            cache.Put(1, "a");
+            cache.Put(2, "b");
+            auto value = cache.Take(1);
+            expect(value.has_value());
+            expect(*value == "a");
+            // The taken value belongs to the caller now
+            expect(evicted.empty());
+            expect(1_u == cache.GetSize());
+            expect(!cache.Take(1).has_value());
+            expect(!cache.Take(3).has_value());
+        };
+
+        "shrink"_test = [] {
+            std::vector<std::string> evicted;
+            LruCache<int, std::string> cache{4, [&](std::string &v) { evicted.push_back(v); }};
+            cache.Put(1, "a");
+            cache.Put(2, "b");
+            cache.Put(3, "c");
+            cache.Put(4, "d");
+            cache.Take(2);
+            cache.Put(2, "b");
+            // The oldest are evicted to fit the new capacity
+            cache.SetCapacity(2);
+            expect(2_u == cache.GetCapacity());
+            expect(std::vector<std::string>{"a", "c"} == evicted);
+            expect(2_u == cache.GetSize());
+            expect(cache.Take(4).has_value());
+            expect(cache.Take(2).has_value());
+
+            evicted.clear();
+            cache.SetCapacity(0);
+            cache.Put(5, "e");
+            expect(std::vector<std::string>{"e"} == evicted);
+            expect(0_u == cache.GetSize());
+        };
+
+        "clear"_test = [] {
+            std::vector<std::string> evicted;
+            {
+                LruCache<int, std::string> cache{3, [&](std::string &v) { evicted.push_back(v); }};
+                cache.Put(1, "a");
+                cache.Clear();
+                expect(std::vector<std::string>{"a"} == evicted);
+                expect(0_u == cache.GetSize());
+                cache.Put(2, "b");
+            }
+            // The rest are released on destruction
+            expect(std::vector<std::string>{"a", "b"} == evicted);
+        };
+    };
+};
+
+} //namespace;
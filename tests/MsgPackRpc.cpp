@@ -0,0 +1,223 @@
+#include <boost/ut.hpp>
+#include <msgpack.hpp>
+#include <uv.h>
+#define private public
+#include "../src/MsgPackRpc.hpp"
+#undef private
+#include "../src/Coroutine.hpp"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+using namespace boost::ut;
+
+// Pretend neovim has responded to the request seq
+void Respond(MsgPackRpc &rpc, uint32_t seq, int value)
+{
+    rpc._Complete(seq, msgpack::object{}, msgpack::object{value});
+}
+
+Coroutine Sequence(MsgPackRpc &rpc, std::vector<uint64_t> &results)
+{
+    auto res = co_await rpc.Call("nvim_eval", "1");
+    results.push_back(res.result.as<uint64_t>());
+    res = co_await rpc.Call("nvim_eval", "2");
+    results.push_back(res.result.as<uint64_t>());
+}
+
+Coroutine Pipeline(MsgPackRpc &rpc, std::vector<uint64_t> &results)
+{
+    auto a = rpc.Call("nvim_eval", "1");
+    auto b = rpc.Call("nvim_eval", "2");
+    results.push_back((co_await a).result.as<uint64_t>());
+    results.push_back((co_await b).result.as<uint64_t>());
+}
+
+Coroutine Await(MsgPackRpc &rpc, std::string &error)
+{
+    auto res = co_await rpc.Call("nvim_eval", "1");
+    error = res.err.as<std::string>();
+}
+
+Coroutine Throw(MsgPackRpc &rpc, bool &resumed, bool &finished)
+{
+    auto res = co_await rpc.Call("nvim_eval", "1");
+    resumed = true;
+    if (!res.err.is_nil())
+        throw std::runtime_error(res.err.as<std::string>());
+    finished = true;
+}
+
+suite s = [] {
+    "MsgPackRpc"_test = [] {
+        uv_loop_t loop;
+        uv_loop_init(&loop);
+        uv_file fds[2];
+        expect(0 == uv_pipe(fds, 0, 0));
+        uv_pipe_t out, in;
+        uv_pipe_init(&loop, &out, 0);
+        uv_pipe_open(&out, fds[1]);
+        uv_pipe_init(&loop, &in, 0);
+        uv_pipe_open(&in, fds[0]);
+        {
+            MsgPackRpc rpc{reinterpret_cast<uv_stream_t *>(&out), reinterpret_cast<uv_stream_t *>(&in), [](const char *) { }};
+
+            "sequence"_test = [&] {
+                std::vector<uint64_t> results;
+                uint32_t seq = rpc._seq;
+                Sequence(rpc, results);
+                // The second request is only sent after the first response
+                expect(1_u == rpc.GetStats().in_flight);
+                Respond(rpc, seq, 10);
+                expect(std::vector<uint64_t>{10} == results);
+                expect(1_u == rpc.GetStats().in_flight);
+                Respond(rpc, seq + 1, 20);
+                expect(std::vector<uint64_t>{10, 20} == results);
+                expect(0_u == rpc.GetStats().in_flight);
+            };
+
+            "pipeline"_test = [&] {
+                std::vector<uint64_t> results;
+                uint32_t seq = rpc._seq;
+                Pipeline(rpc, results);
+                expect(2_u == rpc.GetStats().in_flight);
+                // The second response comes before it's awaited
+                Respond(rpc, seq + 1, 2);
+                expect(results.empty());
+                Respond(rpc, seq, 1);
+                expect(std::vector<uint64_t>{1, 2} == results);
+                expect(0_u == rpc.GetStats().in_flight);
+            };
+
+            "pending"_test = [&] {
+                // More requests in flight than the initial capacity, completed in random order
+                std::vector<uint32_t> seqs;
+                std::vector<int> responses(300);
+                for (int i = 0; i < 300; ++i)
+                {
+                    seqs.push_back(rpc._seq);
+                    rpc.Request([](MsgPackRpc::PackerT &pk) {
+                            pk.pack("nvim_get_mode");
+                            pk.pack_array(0);
+                        },
+                        [&responses, i](const msgpack::object &, const msgpack::object &result) {
+                            responses[i] += result.as<int>() == i;
+                        });
+                }
+                expect(300_u == rpc.GetStats().in_flight);
+                expect(rpc._pending.size() >= 300_u);
+                std::mt19937 gen{42};
+                std::vector<int> order(300);
+                std::iota(order.begin(), order.end(), 0);
+                std::shuffle(order.begin(), order.end(), gen);
+                for (int i : order)
+                    Respond(rpc, seqs[i], i);
+                expect(std::all_of(responses.begin(), responses.end(), [](int r) { return r == 1; }));
+                expect(0_u == rpc.GetStats().in_flight);
+                expect(300_u == rpc.GetStats().max_in_flight);
+
+                // A repeated or an unknown response is ignored
+                auto completed = rpc.GetStats().completed;
+                Respond(rpc, seqs[0], 0);
+                Respond(rpc, rpc._seq + 5, 0);
+                expect(completed == rpc.GetStats().completed);
+                expect(1_i == responses[0]);
+            };
+
+            "timeout"_test = [&] {
+                bool session_error{};
+                rpc._on_error = [&](const char *) { session_error = true; };
+                rpc.SetTimeout(std::chrono::milliseconds{5});
+                uint32_t seq = rpc._seq;
+                int responses{};
+                std::string error;
+                rpc.Request([](MsgPackRpc::PackerT &pk) {
+                        pk.pack("nvim_get_mode");
+                        pk.pack_array(0);
+                    },
+                    [&](const msgpack::object &err, const msgpack::object &) {
+                        ++responses;
+                        error = err.as<std::string>();
+                    });
+                while (error.empty())
+                    uv_run(&loop, UV_RUN_ONCE);
+                expect(1_i == responses);
+                expect(error == MsgPackRpc::TIMEOUT_ERROR);
+                expect(1_u == rpc.GetStats().timed_out);
+                expect(0_u == rpc.GetStats().in_flight);
+                // Not fatal to the session
+                expect(!session_error);
+                // The late response is ignored
+                Respond(rpc, seq, 0);
+                expect(1_i == responses);
+                rpc.SetTimeout(MsgPackRpc::DEFAULT_TIMEOUT);
+                rpc._on_error = [](const char *) { };
+            };
+
+            "timeout await"_test = [&] {
+                rpc.SetTimeout(std::chrono::milliseconds{5});
+                uint32_t seq = rpc._seq;
+                std::string error;
+                // The coroutine is resumed with the error and finishes
+                Await(rpc, error);
+                while (error.empty())
+                    uv_run(&loop, UV_RUN_ONCE);
+                expect(error == MsgPackRpc::TIMEOUT_ERROR);
+                expect(2_u == rpc.GetStats().timed_out);
+                expect(0_u == rpc.GetStats().in_flight);
+                Respond(rpc, seq, 0);
+                rpc.SetTimeout(MsgPackRpc::DEFAULT_TIMEOUT);
+            };
+
+            "throw"_test = [&] {
+                uint32_t seq = rpc._seq;
+                bool resumed{}, finished{};
+                Throw(rpc, resumed, finished);
+                // The error escapes the coroutine, it's logged and swallowed
+                rpc._Complete(seq, msgpack::object{"failed"}, msgpack::object{});
+                expect(resumed);
+                expect(!finished);
+                expect(0_u == rpc.GetStats().in_flight);
+            };
+
+            "batch"_test = [&] {
+                // Let the previous requests be written
+                uv_run(&loop, UV_RUN_NOWAIT);
+                uv_run(&loop, UV_RUN_NOWAIT);
+                expect(rpc._writes_in_flight.empty());
+                for (int i = 0; i < 3; ++i)
+                {
+                    rpc.Request([](MsgPackRpc::PackerT &pk) {
+                            pk.pack("nvim_input");
+                            pk.pack_array(0);
+                        },
+                        [](const msgpack::object &, const msgpack::object &) { });
+                }
+                // Packed, but not written yet
+                expect(rpc._out.size() > 0_u);
+                expect(rpc._writes_in_flight.empty());
+                // A single write for all of them
+                rpc._Flush();
+                expect(0_u == rpc._out.size());
+                expect(1_u == rpc._writes_in_flight.size());
+            };
+
+            // Let the requests be written
+            uv_run(&loop, UV_RUN_NOWAIT);
+        }
+        auto close = [](uv_pipe_t &pipe) {
+            uv_close(reinterpret_cast<uv_handle_t *>(&pipe), nullptr);
+        };
+        close(in);
+        close(out);
+        uv_run(&loop, UV_RUN_DEFAULT);
+        uv_loop_close(&loop);
+    };
+};
+
+} //namespace;
@@ -2,18 +2,50 @@
 #define private public
 #include "../src/Renderer.hpp"
 #undef private
+#include "../src/IWindow.hpp"
 #include <string>
+#include <random>
 
 namespace {
 
 using namespace boost::ut;
 using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+// Split the whole line comparing the raw hl ids
+std::vector<size_t> SplitChunks(const Renderer::_Line &line)
+{
+    ChunkSplitter splitter;
+    uint32_t *cells = splitter.GetCells(line.hl_id.size());
+    for (size_t i = 0; i < line.hl_id.size(); ++i)
+        cells[i] = ChunkSplitter::Pack(line.hl_id[i], line.text[i] == " ");
+    return splitter.Split();
+}
+
+// Split the whole line comparing the highlighting classes
+std::vector<size_t> SplitChunks(const Renderer::_Line &line, const std::vector<unsigned> &hl_class)
+{
+    ChunkSplitter splitter;
+    return Renderer::_SplitChunks(line, hl_class, splitter, 0, line.hl_id.size());
+}
+
+struct FakeWindow : IWindow
+{
+    int presents{};
+    int cursor_presents{};
+
+    void Present() override { ++presents; }
+    void PresentCursor() override { ++cursor_presents; }
+    void SessionEnd() override { }
+    void SetError(const char *) override { }
+    void SetGuiFont(const std::string &) override { }
+};
 
 suite s = [] {
     "SplitChunks"_test = [] {
         "empty"_test = [] {
             Renderer::_Line line;
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(2_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(1_u == chunks[1]);
@@ -24,7 +56,7 @@ suite s = [] {
                 .text = {"H"s, "e"s, "l"s, "l"s, "o"s},
                 .hl_id = {0, 0, 0, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(2_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(5_u == chunks[1]);
@@ -35,7 +67,7 @@ suite s = [] {
                 .text = {"a"s, "b"s, "c"s, "d"s},
                 .hl_id = {0, 0, 1, 1},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(3_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(2_u == chunks[1]);
@@ -47,7 +79,7 @@ suite s = [] {
                 .text = {"a"s, "b"s, " "s, " "s, "c"s},
                 .hl_id = {0, 0, 0, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(4_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(2_u == chunks[1]);
@@ -60,7 +92,7 @@ suite s = [] {
                 .text = {" "s, " "s, " "s, "a"s, "b"s},
                 .hl_id = {0, 0, 0, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(3_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(3_u == chunks[1]);
@@ -72,7 +104,7 @@ suite s = [] {
                 .text = {" "s, " "s, "a"s, "b"s},
                 .hl_id = {0, 0, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(3_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(2_u == chunks[1]);
@@ -84,7 +116,7 @@ suite s = [] {
                 .text = {"~"s, " "s, " "s, " "s},
                 .hl_id = {0, 0, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(3_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(1_u == chunks[1]);
@@ -96,13 +128,345 @@ suite s = [] {
                 .text = {"a"s, " "s, " "s, " "s, " "s},
                 .hl_id = {0, 0, 1, 0, 0},
             };
-            auto chunks = Renderer::_SplitChunks(line);
+            auto chunks = SplitChunks(line);
             expect(4_u == chunks.size());
             expect(0_u == chunks[0]);
             expect(2_u == chunks[1]);
             expect(3_u == chunks[2]);
             expect(5_u == chunks[3]);
         };
+
+        "same_class"_test = [] {
+            Renderer::_Line line{
+                .text = {"a"s, "b"s, "c"s, "d"s, "e"s},
+                .hl_id = {0, 1, 2, 2, 3},
+            };
+            // The ids 1 and 2 are visually identical
+            std::vector<unsigned> hl_class{0, 1, 1, 2};
+            auto chunks = SplitChunks(line, hl_class);
+            expect(4_u == chunks.size());
+            expect(0_u == chunks[0]);
+            expect(1_u == chunks[1]);
+            expect(4_u == chunks[2]);
+            expect(5_u == chunks[3]);
+        };
+    };
+
+    "Flush"_test = [] {
+        "dirty_columns"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                HlAttr attr;
+                attr.fg = 0xff0000;
+                renderer.HlAttrDefine(1, attr);
+                attr.fg = 0x00ff00;
+                renderer.HlAttrDefine(2, attr);
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+
+                renderer.GridLine(0, 0, "a", 1, 10);
+                renderer.GridLine(0, 10, " ", 0, 2);
+                renderer.GridLine(0, 12, "b", 2, 10);
+                flush();
+                auto chunks = renderer._grid_lines[0]->chunks;
+                expect(2_u == chunks.size());
+
+                // Only the chunk containing the change is split again
+                renderer.GridLine(0, 15, "c", 2, 1);
+                flush();
+                expect(renderer.GetWidth() - 10 == static_cast<int>(renderer._splitters[0]._count));
+                const auto &new_chunks = renderer._grid_lines[0]->chunks;
+                expect(2_u == new_chunks.size());
+                expect(chunks[0] == new_chunks[0]);
+                expect(12_i == new_chunks[1]->col);
+                expect(10_i == new_chunks[1]->width);
+                expect(1_u == new_chunks[1]->words.size());
+                expect("bbbcbbbbbb"sv == new_chunks[1]->words[0].text);
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "background"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                HlAttr attr;
+                attr.fg = 0xff0000;
+                renderer.HlAttrDefine(1, attr);
+                attr.bg = 0x0000ff;
+                renderer.HlAttrDefine(2, attr);
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+
+                renderer.GridLine(0, 0, "a", 1, 10);
+                flush();
+                auto chunk = renderer._grid_lines[0]->chunks.at(0);
+                expect(renderer._grid_lines[0]->backgrounds.empty());
+
+                // Like a cursorline: the background changes, the text is the same
+                renderer.GridLine(0, 0, "a", 2, 10);
+                renderer.GridLine(0, 10, " ", 2, 20);
+                flush();
+                const auto &line_row = renderer._grid_lines[0];
+                expect(1_u == line_row->chunks.size());
+                expect(chunk == line_row->chunks[0]);
+                expect(1_u == line_row->backgrounds.size());
+                const auto &bg = line_row->backgrounds[0];
+                expect(0_i == bg->col);
+                expect(30_i == bg->width);
+                expect(0x0000ff_u == bg->bg);
+                expect(bg->words.empty());
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "dirty_columns_random"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                HlAttr attr;
+                attr.fg = 0xff0000;
+                renderer.HlAttrDefine(1, attr);
+                attr.fg = 0x00ff00;
+                renderer.HlAttrDefine(2, attr);
+                // The runs of spaces with the background are visible
+                attr.bg = 0x0000ff;
+                renderer.HlAttrDefine(3, attr);
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+                std::mt19937 gen{42};
+                int mismatches{};
+                for (int i = 0; i < 1000; ++i)
+                {
+                    // A few short edits of spaces and letters in different highlighting
+                    for (int j = 0, n = 1 + gen() % 3; j < n; ++j)
+                    {
+                        int col = gen() % renderer.GetWidth();
+                        int repeat = 1 + gen() % std::min(4, renderer.GetWidth() - col);
+                        renderer.GridLine(0, col, gen() % 2 ? " " : "x", gen() % 4, repeat);
+                    }
+                    flush();
+                    auto partial = renderer._grid_lines[0];
+                    // Compare with the row built from scratch
+                    renderer._lines[0].Invalidate();
+                    flush();
+                    auto full = renderer._grid_lines[0];
+                    if (!partial != !full || (partial && *partial != *full))
+                        ++mismatches;
+                }
+                expect(0_i == mismatches);
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "parallel"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                HlAttr attr;
+                attr.fg = 0xff0000;
+                renderer.HlAttrDefine(1, attr);
+                attr.bg = 0x0000ff;
+                renderer.HlAttrDefine(2, attr);
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+                std::mt19937 gen{42};
+                for (int row = 0; row < static_cast<int>(renderer._lines.size()); ++row)
+                {
+                    for (int col = 0; col < renderer.GetWidth(); )
+                    {
+                        int repeat = 1 + gen() % std::min(5, renderer.GetWidth() - col);
+                        renderer.GridLine(row, col, gen() % 2 ? " " : "x", gen() % 3, repeat);
+                        col += repeat;
+                    }
+                }
+                // All the rows are dirty: built by the workers
+                flush();
+                auto parallel = renderer._grid_lines;
+
+                // One row at a time: built serially
+                int mismatches{};
+                for (int row = 0; row < static_cast<int>(renderer._lines.size()); ++row)
+                {
+                    renderer._lines[row].restyle = true;
+                    renderer._lines[row].Invalidate();
+                    flush();
+                    const auto &serial = renderer._grid_lines[row];
+                    if (!parallel[row] != !serial || (serial && *parallel[row] != *serial))
+                        ++mismatches;
+                }
+                expect(0_i == mismatches);
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "default_colors"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+
+                // The highlighting of the last row stays the same all along
+                HlAttr blue;
+                blue.fg = 0x0000ff;
+                renderer.HlAttrDefine(3, blue);
+                renderer.GridLine(0, 0, "a", 1, 10);
+                renderer.GridLine(1, 0, "b", 2, 10);
+                renderer.GridLine(2, 0, "c", 3, 10);
+                flush();
+                auto getStyles = [&] {
+                    std::vector<std::string> styles;
+                    for (int row = 0; row < 3; ++row)
+                    {
+                        const auto &word = renderer._grid_lines[row]->chunks.at(0)->words.at(0);
+                        styles.push_back(renderer._hl_table.GetText(word.text_class).pango_style);
+                    }
+                    return styles;
+                };
+                // Switch the color schemes, the highlighting table gets compacted
+                bool compacted{};
+                for (uint32_t scheme = 1; scheme <= 10; ++scheme)
+                {
+                    auto class_count = renderer._hl_table.GetClassCount();
+                    auto styles = getStyles();
+                    HlAttr attr;
+                    attr.fg = scheme;
+                    renderer.HlAttrDefine(1, attr);
+                    attr.flags = HlAttr::F_REVERSE;
+                    renderer.HlAttrDefine(2, attr);
+                    renderer.DefaultColorSet(0xffffff, scheme);
+                    // The window may present the rows of the old colors until the flush
+                    expect(!renderer.IsDefAttrModified());
+                    expect(styles == getStyles());
+                    flush();
+                    expect(renderer.IsDefAttrModified());
+                    renderer.MarkAttrMapProcessed();
+                    compacted |= renderer._hl_table.GetClassCount() < class_count;
+                }
+                expect(compacted);
+                // All the words refer to the text classes of their current highlighting
+                const auto &hl_table = renderer._hl_table;
+                for (int row = 0; row < 3; ++row)
+                {
+                    const auto &word = renderer._grid_lines[row]->chunks.at(0)->words.at(0);
+                    expect(word.text_class == hl_table.GetTextClass(row + 1));
+                    expect(hl_table.GetText(word.text_class).pango_style == hl_table[hl_table.GetClass(row + 1)].pango_style);
+                }
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "cursor_only"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                FakeWindow window;
+                renderer.SetWindow(&window);
+                auto flush = [&] {
+                    renderer._is_clean = true;
+                    renderer._DoFlush();
+                };
+
+                renderer.GridLine(0, 0, "a", 0, 1);
+                flush();
+                expect(1_i == window.presents);
+                expect(0_i == window.cursor_presents);
+
+                renderer.GridCursorGoto(1, 2);
+                flush();
+                expect(1_i == window.presents);
+                expect(1_i == window.cursor_presents);
+                auto cursor = renderer.GetCursorState();
+                expect(1_u == cursor.row);
+                expect(2_u == cursor.col);
+
+                renderer.SetBusy(true);
+                flush();
+                expect(2_i == window.presents);
+                expect(renderer.GetCursorState().busy);
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
+
+        "cursor_style"_test = [] {
+            uv_loop_t loop;
+            uv_loop_init(&loop);
+            {
+                AsyncExec exec{&loop};
+                Renderer renderer{exec, nullptr};
+                HlAttr cursor_attr;
+                cursor_attr.bg = 0x00ff00;
+                cursor_attr.blend = 30;
+                renderer.HlAttrDefine(5, cursor_attr);
+                // The reversed highlighting paints the cursor with its foreground
+                HlAttr reverse_attr;
+                reverse_attr.fg = 0xff0000;
+                reverse_attr.flags = HlAttr::F_REVERSE;
+                renderer.HlAttrDefine(6, reverse_attr);
+                renderer.ModeInfoSet(true, {
+                    CursorStyle{.name = "normal"},
+                    CursorStyle{.shape = CursorStyle::VERTICAL, .cell_percentage = 25, .attr_id = 5, .name = "insert"},
+                    CursorStyle{.attr_id = 6, .name = "replace"},
+                });
+
+                renderer.ModeChange("insert", 1);
+                renderer._is_clean = true;
+                renderer._DoFlush();
+                auto cursor = renderer.GetCursorState();
+                expect(1_u == cursor.mode_idx);
+                expect(0x00ff00_u == cursor.color);
+                // The blend comes with the highlighting
+                expect(30_u == cursor.blend);
+
+                renderer.ModeChange("normal", 0);
+                renderer._is_clean = true;
+                renderer._DoFlush();
+                cursor = renderer.GetCursorState();
+                expect(0_u == cursor.mode_idx);
+                expect(renderer.GetFg() == cursor.color);
+                expect(0_u == cursor.blend);
+
+                renderer.ModeChange("replace", 2);
+                renderer._is_clean = true;
+                renderer._DoFlush();
+                cursor = renderer.GetCursorState();
+                expect(2_u == cursor.mode_idx);
+                expect(0xff0000_u == cursor.color);
+                expect(0_u == cursor.blend);
+            }
+            uv_run(&loop, UV_RUN_DEFAULT);
+            uv_loop_close(&loop);
+        };
     };
 };
 
@@ -0,0 +1,63 @@
+#include <boost/ut.hpp>
+#include "../src/SlabPool.hpp"
+#include "../src/GridLine.hpp"
+#include <thread>
+#include <vector>
+
+namespace {
+
+using namespace boost::ut;
+
+suite s = [] {
+    "SlabPool"_test = [] {
+        "reuse"_test = [] {
+            SlabPool pool;
+            void *a = pool.Allocate(40);
+            void *b = pool.Allocate(48);
+            expect(a != b);
+            expect(1_u == pool.GetSlabCount());
+            pool.Deallocate(a, 40);
+            // The freed block is recycled for the same size class
+            expect(a == pool.Allocate(33));
+            // Other size classes get their own slabs
+            pool.Allocate(100);
+            expect(2_u == pool.GetSlabCount());
+        };
+
+        "shared_chunk"_test = [] {
+            auto chunk = std::allocate_shared<GridLine::Chunk>(SlabAllocator<GridLine::Chunk>{}, 3, GridLine::Chunk::WordsT{});
+            expect(3_i == chunk->width);
+            auto slabs = SlabPool::Shared().GetSlabCount();
+            chunk.reset();
+            for (int i = 0; i < 1000; ++i)
+                chunk = std::allocate_shared<GridLine::Chunk>(SlabAllocator<GridLine::Chunk>{}, i, GridLine::Chunk::WordsT{});
+            // The released chunks are recycled
+            expect(slabs == SlabPool::Shared().GetSlabCount());
+        };
+
+        "threads"_test = [] {
+            auto &pool = SlabPool::Shared();
+            std::vector<void *> blocks(1000);
+            // The blocks are allocated by a short lived thread and freed by this one
+            auto pass = [&] {
+                std::thread producer{[&] {
+                    for (auto &block : blocks)
+                        block = pool.Allocate(200);
+                }};
+                producer.join();
+                for (auto *block : blocks)
+                    pool.Deallocate(block, 200);
+            };
+            // Let the thread caches settle
+            pass();
+            pass();
+            auto slabs = pool.GetSlabCount();
+            for (int i = 0; i < 10; ++i)
+                pass();
+            // The blocks flow back to the pool through the thread caches
+            expect(slabs == pool.GetSlabCount());
+        };
+    };
+};
+
+} //namespace;
@@ -0,0 +1,78 @@
+#include <boost/ut.hpp>
+#include "../src/WorkerPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+
+namespace {
+
+using namespace boost::ut;
+
+suite s = [] {
+    "WorkerPool"_test = [] {
+        "every_index"_test = [] {
+            WorkerPool pool{3};
+            expect(4_u == pool.GetWorkerCount());
+            for (size_t count : {0, 1, 5, 1000})
+            {
+                std::vector<std::atomic<int>> done(count);
+                std::atomic<int> bad_workers{};
+                pool.ParallelFor(count, [&](size_t i, unsigned worker) {
+                    ++done[i];
+                    if (worker >= pool.GetWorkerCount())
+                        ++bad_workers;
+                });
+                expect(0_i == bad_workers);
+                for (auto &d : done)
+                    expect(1_i == d);
+            }
+        };
+
+        "serial"_test = [] {
+            WorkerPool pool{0};
+            std::vector<size_t> order;
+            pool.ParallelFor(10, [&](size_t i, unsigned worker) {
+                expect(0_u == worker);
+                order.push_back(i);
+            });
+            expect(10_u == order.size());
+            expect(std::is_sorted(order.begin(), order.end()));
+        };
+
+        "no_copy"_test = [] {
+            // A move-only job is taken by reference
+            WorkerPool pool{2};
+            auto sum = std::make_unique<std::atomic<size_t>>();
+            auto *result = sum.get();
+            auto job = [sum = std::move(sum)](size_t i, unsigned) { *sum += i; };
+            pool.ParallelFor(100, job);
+            expect(4950_u == result->load());
+        };
+
+        "exception"_test = [] {
+            WorkerPool pool{2};
+            std::atomic<int> done{};
+            bool thrown{};
+            try
+            {
+                pool.ParallelFor(100, [&](size_t i, unsigned) {
+                    if (i == 50)
+                        throw std::runtime_error("fail");
+                    ++done;
+                });
+            }
+            catch (const std::runtime_error &)
+            {
+                thrown = true;
+            }
+            expect(thrown);
+            // The rest of the jobs still run, and the pool is usable afterwards
+            expect(99_i == done);
+            pool.ParallelFor(100, [&](size_t, unsigned) { ++done; });
+            expect(199_i == done);
+        };
+    };
+};
+
+} //namespace;